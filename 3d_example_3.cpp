@@ -2,7 +2,9 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <string>
 #include <vector>
+#include "frame_allocator.h"
 
 // Define the surface class
 class Surface {
@@ -10,7 +12,7 @@ public:
     Surface(std::string name, glm::vec3 center, float radius, float height, std::vector<glm::vec3> points)
         : name(name), center(center), radius(radius), height(height), points(points) {}
 
-    void draw(glm::mat4& modelMatrix, GLContext* glContext) {
+    void draw(glm::mat4& modelMatrix, GLContext* glContext, FrameAllocator& scratch) const {
         // Set up vertex buffer object (VBO) and index buffer object (IBO)
         int vboIndex = 0;
         int iboIndex = 0;
@@ -20,23 +22,25 @@ public:
         glBindBuffer(GL_ARRAY_BUFFER, vboIndex);
         glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(glm::vec3), points.data(), GL_STATIC_DRAW);
 
-        // Create IBO for surface edges
+        // Create IBO for surface edges. The index list is only needed until it is uploaded, so it is built in
+        // frame scratch memory instead of a heap-allocated vector.
         glGenBuffers(1, &iboIndex);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboIndex);
-        std::vector<int> indices;
-        for (int i = 0; i < points.size() - 1; ++i) {
-            indices.push_back(i * 3 + 0); // x
-            indices.push_back(i * 3 + 2); // z
-            indices.push_back((i + 1) * 3 + 0); // x
+        size_t indexCount = points.size() > 1 ? (points.size() - 1) * 3 : 0;
+        int* indices = scratch.allocateArray<int>(indexCount);
+        for (size_t i = 0; i + 1 < points.size(); ++i) {
+            indices[i * 3 + 0] = i * 3 + 0; // x
+            indices[i * 3 + 1] = i * 3 + 2; // z
+            indices[i * 3 + 2] = (i + 1) * 3 + 0; // x
         }
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(int), indices, GL_STATIC_DRAW);
 
         // Set up vertex attributes
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
         glEnableVertexAttribArray(0);
 
         // Draw surface
-        glDrawElements(GL_LINE_LOOP, indices.size(), GL_UNSIGNED_INT, (void*)0);
+        glDrawElements(GL_LINE_LOOP, indexCount, GL_UNSIGNED_INT, (void*)0);
 
         // Clean up VBO and IBO
         glDeleteBuffers(1, &vboIndex);
@@ -60,9 +64,9 @@ public:
         surfaces.push_back(surface);
     }
 
-    void draw(glm::mat4& modelMatrix, GLContext* glContext) {
+    void draw(glm::mat4& modelMatrix, GLContext* glContext, FrameAllocator& scratch) {
         for (const Surface& surface : surfaces) {
-            surface.draw(modelMatrix, glContext);
+            surface.draw(modelMatrix, glContext, scratch);
         }
     }
 
@@ -96,11 +100,14 @@ public:
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Draw model
-        model->draw(modelMatrix, this);
+        model->draw(modelMatrix, this, frameAllocator);
 
         // Swap buffers and poll events
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        // Everything allocated from scratch memory two frames ago can now be reused
+        frameAllocator.endFrame();
     }
 
 private:
@@ -108,6 +115,9 @@ private:
     Model* model;
 
     glm::mat4 modelMatrix;
+
+    // Scratch memory for per-frame temporary buffers
+    FrameAllocator frameAllocator{64 * 1024};
 };
 
 int main() {
@@ -144,6 +154,11 @@ In the main loop, the `drawModel()` function is called repeatedly to draw the mo
 `glContext.drawModel()` call uses the current camera position and rotation to transform the model before drawing
 it.
 
+Temporary data built while drawing, such as the index list of each surface, comes from a `FrameAllocator`
+owned by the GL context instead of the heap. It hands out memory by bumping a pointer and is rewound in constant
+time at the end of each frame, so drawing does not allocate or free anything. The allocator lives in
+frame_allocator.h, which the other render examples share.
+
 Note that this code does not include any user input or interaction, so you would need to add those features
 yourself if you want to create a more interactive application.
 */
\ No newline at end of file
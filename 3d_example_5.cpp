@@ -1,5 +1,38 @@
+// KERNEL_BENCHMARK builds only the data structures and kernels, without SFML or main(), so that
+// 3d_example_kernel_benchmark.cpp can include this file and time the real kernels
+#ifndef KERNEL_BENCHMARK
 #include <SFML/Graphics.hpp>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
 #include <vector>
+#include "simd_dispatch.h"
+#include "worker_pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POLYGON_HAS_X86_SIMD 1
+#endif
+
+// Keep multiply-adds unfused so the scalar and SIMD transform kernels round identically, even when the whole
+// file is built with -march=native on an FMA-capable CPU
+#if defined(__clang__)
+#pragma float_control(push)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
 
 // Define a 3D point structure
 struct Point {
@@ -8,79 +41,382 @@ struct Point {
     // Constructor to initialize point with coordinates
     Point(float x = 0.0f, float y = 0.0f, float z = 0.0f) : x(x), y(y), z(z) {}
 
+#ifndef KERNEL_BENCHMARK
     // Function to draw the point as a sphere in SFML window
     void draw(sf::RenderWindow& window) {
         sf:: SphereShape sphere(2);
         sphere.setPosition(x, y, z);
         window.draw(sphere);
     }
+#endif
+};
+
+// Allocator that hands out cache-line aligned storage so the SIMD kernels never straddle a line
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, std::size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+
+// Structure-of-arrays vertex storage: each coordinate lives in its own aligned array, so a batch
+// transform loads 4/8/16 x's (or y's, z's) with a single instruction instead of gathering from {x, y, z}
+struct PointsSoA {
+    AlignedFloats x, y, z;
+
+    PointsSoA() = default;
+    PointsSoA(const std::vector<Point>& points) { assign(points); }
+
+    void assign(const std::vector<Point>& points) {
+        resize(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            x[i] = points[i].x;
+            y[i] = points[i].y;
+            z[i] = points[i].z;
+        }
+    }
+
+    void resize(std::size_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+    }
+
+    void push_back(const Point& p) {
+        x.push_back(p.x);
+        y.push_back(p.y);
+        z.push_back(p.z);
+    }
+
+    std::size_t size() const { return x.size(); }
+
+    Point operator[](std::size_t i) const { return Point(x[i], y[i], z[i]); }
 };
 
+// Row-major 3x4 affine matrix: p' = M[:, 0..2] * p + M[:, 3]
+struct Affine3x4 {
+    float m[3][4];
+
+    static Affine3x4 identity() {
+        return {{{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}}};
+    }
+
+    static Affine3x4 rotationX(float angle) {
+        float s = std::sin(angle / 57.2957795131f);
+        float c = std::cos(angle / 57.2957795131f);
+        return {{{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, c, -s, 0.0f}, {0.0f, s, c, 0.0f}}};
+    }
+
+    static Affine3x4 rotationY(float angle) {
+        float s = std::sin(angle / 57.2957795131f);
+        float c = std::cos(angle / 57.2957795131f);
+        return {{{c, 0.0f, s, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {-s, 0.0f, c, 0.0f}}};
+    }
+
+    static Affine3x4 scaling(float factor) {
+        return {{{factor, 0.0f, 0.0f, 0.0f}, {0.0f, factor, 0.0f, 0.0f}, {0.0f, 0.0f, factor, 0.0f}}};
+    }
+};
+
+// Signature shared by every transform kernel. Input and output may alias (in-place transform).
+using TransformKernel = void (*)(const Affine3x4& m, const float* x, const float* y, const float* z,
+                                 float* outX, float* outY, float* outZ, std::size_t n);
+
+// Reference kernel. The SIMD kernels evaluate ((m0*x + m1*y) + m2*z) + m3 in exactly this order so that
+// every path produces bit-identical results.
+static void transformPointsScalar(const Affine3x4& m, const float* x, const float* y, const float* z,
+                                  float* outX, float* outY, float* outZ, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        float px = x[i], py = y[i], pz = z[i];
+        outX[i] = m.m[0][0] * px + m.m[0][1] * py + m.m[0][2] * pz + m.m[0][3];
+        outY[i] = m.m[1][0] * px + m.m[1][1] * py + m.m[1][2] * pz + m.m[1][3];
+        outZ[i] = m.m[2][0] * px + m.m[2][1] * py + m.m[2][2] * pz + m.m[2][3];
+    }
+}
+
+#ifdef POLYGON_HAS_X86_SIMD
+__attribute__((target("sse2")))
+static void transformPointsSSE2(const Affine3x4& m, const float* x, const float* y, const float* z,
+                                float* outX, float* outY, float* outZ, std::size_t n) {
+    __m128 r[3][4];
+    for (int row = 0; row < 3; ++row)
+        for (int col = 0; col < 4; ++col)
+            r[row][col] = _mm_set1_ps(m.m[row][col]);
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 res[3];
+        for (int row = 0; row < 3; ++row) {
+            __m128 acc = _mm_add_ps(_mm_mul_ps(r[row][0], px), _mm_mul_ps(r[row][1], py));
+            acc = _mm_add_ps(acc, _mm_mul_ps(r[row][2], pz));
+            res[row] = _mm_add_ps(acc, r[row][3]);
+        }
+        _mm_storeu_ps(outX + i, res[0]);
+        _mm_storeu_ps(outY + i, res[1]);
+        _mm_storeu_ps(outZ + i, res[2]);
+    }
+    transformPointsScalar(m, x + i, y + i, z + i, outX + i, outY + i, outZ + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void transformPointsAVX2(const Affine3x4& m, const float* x, const float* y, const float* z,
+                                float* outX, float* outY, float* outZ, std::size_t n) {
+    __m256 r[3][4];
+    for (int row = 0; row < 3; ++row)
+        for (int col = 0; col < 4; ++col)
+            r[row][col] = _mm256_set1_ps(m.m[row][col]);
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 pz = _mm256_loadu_ps(z + i);
+        __m256 res[3];
+        for (int row = 0; row < 3; ++row) {
+            __m256 acc = _mm256_add_ps(_mm256_mul_ps(r[row][0], px), _mm256_mul_ps(r[row][1], py));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(r[row][2], pz));
+            res[row] = _mm256_add_ps(acc, r[row][3]);
+        }
+        _mm256_storeu_ps(outX + i, res[0]);
+        _mm256_storeu_ps(outY + i, res[1]);
+        _mm256_storeu_ps(outZ + i, res[2]);
+    }
+    transformPointsScalar(m, x + i, y + i, z + i, outX + i, outY + i, outZ + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void transformPointsAVX512(const Affine3x4& m, const float* x, const float* y, const float* z,
+                                  float* outX, float* outY, float* outZ, std::size_t n) {
+    __m512 r[3][4];
+    for (int row = 0; row < 3; ++row)
+        for (int col = 0; col < 4; ++col)
+            r[row][col] = _mm512_set1_ps(m.m[row][col]);
+
+    // The tail is handled with a lane mask instead of a scalar loop
+    for (std::size_t i = 0; i < n; i += 16) {
+        std::size_t remaining = n - i;
+        __mmask16 mask = remaining >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << remaining) - 1u);
+        __m512 px = _mm512_maskz_loadu_ps(mask, x + i);
+        __m512 py = _mm512_maskz_loadu_ps(mask, y + i);
+        __m512 pz = _mm512_maskz_loadu_ps(mask, z + i);
+        __m512 res[3];
+        for (int row = 0; row < 3; ++row) {
+            __m512 acc = _mm512_add_ps(_mm512_mul_ps(r[row][0], px), _mm512_mul_ps(r[row][1], py));
+            acc = _mm512_add_ps(acc, _mm512_mul_ps(r[row][2], pz));
+            res[row] = _mm512_add_ps(acc, r[row][3]);
+        }
+        _mm512_mask_storeu_ps(outX + i, mask, res[0]);
+        _mm512_mask_storeu_ps(outY + i, mask, res[1]);
+        _mm512_mask_storeu_ps(outZ + i, mask, res[2]);
+    }
+}
+#endif
+
+TransformKernel transformKernelFor(SimdPath path) {
+#ifdef POLYGON_HAS_X86_SIMD
+    switch (path) {
+        case SimdPath::SSE2: return transformPointsSSE2;
+        case SimdPath::AVX2: return transformPointsAVX2;
+        case SimdPath::AVX512: return transformPointsAVX512;
+        default: break;
+    }
+#endif
+    return transformPointsScalar;
+}
+
+// Batch transform entry point: dispatches once, on first use, to the best kernel for this CPU
+void transformPoints(const Affine3x4& m, const float* x, const float* y, const float* z, float* outX,
+                     float* outY, float* outZ, std::size_t n) {
+    static const TransformKernel kernel = transformKernelFor(detectSimdPath());
+    kernel(m, x, y, z, outX, outY, outZ, n);
+}
+
+void transformPoints(const Affine3x4& m, const PointsSoA& in, PointsSoA& out) {
+    out.resize(in.size());
+    transformPoints(m, in.x.data(), in.y.data(), in.z.data(), out.x.data(), out.y.data(), out.z.data(),
+                    in.size());
+}
+
+// Function to check that every supported SIMD path matches the scalar kernel bit for bit
+bool verifyTransformKernels() {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+
+    Affine3x4 m;
+    for (auto& row : m.m)
+        for (float& value : row)
+            value = dist(rng);
+
+    bool allMatch = true;
+    // Odd sizes exercise every tail length of the 4-, 8- and 16-wide kernels
+    for (std::size_t n : {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 33, 1000, 1023}) {
+        PointsSoA in;
+        for (std::size_t i = 0; i < n; ++i) in.push_back(Point(dist(rng), dist(rng), dist(rng)));
+
+        PointsSoA expected(in);
+        transformPointsScalar(m, in.x.data(), in.y.data(), in.z.data(), expected.x.data(), expected.y.data(),
+                              expected.z.data(), n);
+
+        for (SimdPath path : {SimdPath::SSE2, SimdPath::AVX2, SimdPath::AVX512}) {
+            if (!isSimdPathSupported(path)) continue;
+
+            PointsSoA actual(in);
+            transformKernelFor(path)(m, in.x.data(), in.y.data(), in.z.data(), actual.x.data(),
+                                     actual.y.data(), actual.z.data(), n);
+            bool match = std::memcmp(actual.x.data(), expected.x.data(), n * sizeof(float)) == 0 &&
+                         std::memcmp(actual.y.data(), expected.y.data(), n * sizeof(float)) == 0 &&
+                         std::memcmp(actual.z.data(), expected.z.data(), n * sizeof(float)) == 0;
+            if (!match) {
+                std::cout << simdPathName(path) << " transform differs from scalar for n = " << n << std::endl;
+                allMatch = false;
+            }
+        }
+    }
+    return allMatch;
+}
+
 // Define a Polygon class for modeling and transformations
 class Polygon {
 private:
-    std::vector<Point> vertices;
+    PointsSoA vertices;
 
 public:
     // Constructor to initialize polygon with points
     Polygon(const std::vector<Point>& vertices) : vertices(vertices) {}
 
+#ifndef KERNEL_BENCHMARK
     // Function to draw the polygon in SFML window
     void draw(sf::RenderWindow& window) {
         for (size_t i = 0; i < vertices.size(); ++i) {
             Point v1 = vertices[i];
-            if (i + 1 == vertices.size()) { // Close the polygon by connecting back to first vertex
-                Point v2 = vertices[0];
-            } else {
-                Point v2 = vertices[i + 1];
-            }
+            // Close the polygon by connecting back to first vertex
+            Point v2 = vertices[i + 1 == vertices.size() ? 0 : i + 1];
 
             sf::Vertex line[] = {{v1.x, v1.y, v1.z}, {v2.x, v2.y, v2.z}};
             window.draw(line, 2, sf::Lines);
         }
     }
+#endif
+
+    // Direct access to the SoA vertex arrays for batch processing
+    PointsSoA& points() { return vertices; }
+    const PointsSoA& points() const { return vertices; }
+
+    // Function to apply an affine transform to every vertex in one batch
+    void transform(const Affine3x4& m) {
+        transformPoints(m, vertices, vertices);
+    }
 
     // Function to rotate the polygon around X-axis
     void rotateX(float angle) {
-        for (Point& v : vertices) {
-            v.z = std::sin(angle / 57.2957795131f) * v.x - std::cos(angle / 57.2957795131f) * v.y;
-            v.y = std::cos(angle / 57.2957795131f) * v.x + std::sin(angle / 57.2957795131f) * v.z;
-        }
+        transform(Affine3x4::rotationX(angle));
     }
 
     // Function to rotate the polygon around Y-axis
     void rotateY(float angle) {
-        for (Point& v : vertices) {
-            float newX = v.y * std::cos(angle / 57.2957795131f) - v.z * std::sin(angle / 57.2957795131f);
-            float newY = v.x * std::sin(angle / 57.2957795131f) + v.z * std::cos(angle / 57.2957795131f);
-            v.y = newX;
-            v.x = newY;
-
-            // Update z coordinate for rotation
-            Point tempPoint(v.x, v.y, v.z);
-            v.x = newX;
-            v.y = newY;
-        }
+        transform(Affine3x4::rotationY(angle));
     }
 
     // Function to scale the polygon by factor
     void scale(float factor) {
-        for (Point& v : vertices) {
-            v.x *= factor;
-            v.y *= factor;
-            v.z *= factor;
-        }
+        transform(Affine3x4::scaling(factor));
     }
 };
 
+// Vertices per parallel work item: 2048 SoA vertices are 24 KiB, which stays resident in L1/L2 while a chunk
+// is transformed and still leaves dozens of chunks per thread for load balancing on large scenes
+const std::size_t VERTICES_PER_CHUNK = 2048;
+
+// Floats per cache line. Chunk edges fall on multiples of this within each polygon's arrays, so two threads
+// never write the same line.
+const std::size_t FLOATS_PER_CACHE_LINE = 64 / sizeof(float);
+static_assert(VERTICES_PER_CHUNK % FLOATS_PER_CACHE_LINE == 0, "chunks must cover whole cache lines");
+
+// Function to apply one affine transform to every vertex of every polygon using the worker pool.
+// Work is cut by vertex count rather than by polygon: the polygons are laid end to end and the combined
+// vertex range is split into equal chunks, so one huge polygon is spread over several threads while many tiny
+// ones are packed into a single chunk. Each polygon starts on a cache line boundary of the combined range, so
+// chunk edges also fall on cache line boundaries of the polygons' own (64-byte aligned) arrays. Returns after
+// all vertices are transformed, i.e. before drawing.
+void transformPolygons(std::vector<Polygon>& polygons, const Affine3x4& m, WorkerPool& pool) {
+    // firstVertex[p] is the index of polygon p's first vertex in the combined range, rounded up to a cache line
+    std::vector<std::size_t> firstVertex(polygons.size() + 1, 0);
+    for (std::size_t p = 0; p < polygons.size(); ++p) {
+        std::size_t lines = (polygons[p].points().size() + FLOATS_PER_CACHE_LINE - 1) / FLOATS_PER_CACHE_LINE;
+        firstVertex[p + 1] = firstVertex[p] + lines * FLOATS_PER_CACHE_LINE;
+    }
+
+    const std::size_t totalVertices = firstVertex.back();
+    const std::size_t chunkCount = (totalVertices + VERTICES_PER_CHUNK - 1) / VERTICES_PER_CHUNK;
+
+    pool.parallelFor(chunkCount, [&](std::size_t chunk) {
+        std::size_t begin = chunk * VERTICES_PER_CHUNK;
+        std::size_t end = std::min(begin + VERTICES_PER_CHUNK, totalVertices);
+
+        // Find the polygon that holds the chunk's first vertex, then walk forward, skipping the padding
+        std::size_t p = std::upper_bound(firstVertex.begin(), firstVertex.end(), begin) - firstVertex.begin() - 1;
+        for (; p < polygons.size() && firstVertex[p] < end; ++p) {
+            PointsSoA& v = polygons[p].points();
+            std::size_t local = std::max(begin, firstVertex[p]) - firstVertex[p];
+            std::size_t localEnd = std::min(end - firstVertex[p], v.size());
+            if (local >= localEnd) continue;
+            transformPoints(m, v.x.data() + local, v.y.data() + local, v.z.data() + local, v.x.data() + local,
+                            v.y.data() + local, v.z.data() + local, localEnd - local);
+        }
+    });
+}
+
+#ifndef KERNEL_BENCHMARK
 int main() {
+    // Make sure the SIMD transform paths agree with the scalar reference before using them
+    std::cout << "Transform kernel: " << simdPathName(detectSimdPath()) << std::endl;
+    if (!verifyTransformKernels()) {
+        return 1;
+    }
+
     sf::RenderWindow window(sf::VideoMode(800, 600), "Polygonal Modeler");
 
     // Define points of the polygon
     std::vector<Point> vertices = {{0.0f, 0.0f, -5.0f}, {2.0f, 0.0f, -5.0f}, {1.0f, 3.0f, -5.0f}, {0.0f, 4.0f,
 -5.0f}};
 
-    Polygon polygon(vertices);
+    // A production scene holds tens of thousands of polygons of uneven size
+    std::vector<Polygon> polygons;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> sizeDist(3, 400);
+    std::uniform_real_distribution<float> coordDist(-10.0f, 10.0f);
+    for (int i = 0; i < 20000; ++i) {
+        std::vector<Point> points(sizeDist(rng));
+        for (Point& p : points) p = Point(coordDist(rng), coordDist(rng), coordDist(rng) - 20.0f);
+        polygons.emplace_back(points);
+    }
+    polygons.emplace_back(vertices);
+
+    // One pool for the lifetime of the program; the render thread participates in every transform
+    WorkerPool pool;
 
     // Main loop
     while (window.isOpen()) {
@@ -90,19 +426,29 @@ int main() {
                 window.close();
         }
 
-        // Rotate polygon around X-axis
-        float angle = 10.0f; // Change this value to rotate the polygon
-        polygon.rotateX(angle);
+        // Rotate all polygons around X-axis; this returns only when every vertex is updated
+        float angle = 10.0f; // Change this value to rotate the polygons
+        transformPolygons(polygons, Affine3x4::rotationX(angle), pool);
 
         // Draw everything
         window.clear();
 
-        polygon.draw(window);
+        for (Polygon& polygon : polygons) {
+            polygon.draw(window);
+        }
         window.display();
     }
 
     return 0;
 }
+#endif
+
+// Hand the floating-point options back, so a file that includes this one is built with its own
+#if defined(__clang__)
+#pragma float_control(pop)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
 /*
 This code creates a simple polygon with four vertices and allows you to manipulate it by rotating it around the
 X-axis. You can modify the rotation angle in the main loop to change the direction of rotation.
@@ -110,6 +456,16 @@ X-axis. You can modify the rotation angle in the main loop to change the directi
 The Polygon class encapsulates the logic for handling transformations, including rotations and scaling. It uses
 SFML's Vertex class to store 3D points and draw lines between them.
 
+The vertices are kept in structure-of-arrays form (`PointsSoA`), and every transformation is expressed as a 3x4
+affine matrix applied to all vertices in one batch by `transformPoints()`. The batch kernel has scalar, SSE2,
+AVX2 and AVX-512 versions; the widest one the CPU supports is picked at runtime, and `verifyTransformKernels()`
+checks at startup that each SIMD version matches the scalar one exactly. Floating-point contraction is switched
+off for this file so the compiler cannot fuse the multiply-adds of one path into FMAs and break that agreement.
+
+For whole scenes, `transformPolygons()` transforms every polygon in a collection on a `WorkerPool`. The
+combined vertex range is split into cache-sized chunks that the threads claim one at a time, so uneven polygon
+sizes are balanced automatically, and the call returns before the draw phase starts.
+
 You can use this code as a starting point and extend it with additional features such as:
 
 *   Additional transformation methods (Y-axis rotation, Z-axis rotation, etc.)
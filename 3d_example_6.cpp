@@ -1,55 +1,654 @@
 #include <SDL.h>
 #include <GL/glew.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "frame_allocator.h"
 
-// Define a struct to hold the image data
+// Define a struct to hold the texture created from an image
 struct ImageData {
-    unsigned char* pixels;
-    int width, height;
+    int width = 0, height = 0;
+    GLint internalFormat = 0;
+    GLuint textureID = 0;
 };
 
-// Function to load an image file into a buffer
-ImageData loadImage(const char* filename) {
-    ImageData imageData;
-    SDL_Surface* surface = SDL_LoadBMP(filename);
-    if (!surface) return imageData;
+// Function to test whether two byte ranges differ. With SSE2 it XORs 64 bytes at a time and tests the OR of the
+// results, so an unchanged range costs one compare per 64 bytes.
+bool bytesDiffer(const unsigned char* a, const unsigned char* b, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 64 <= n; i += 64) {
+        __m128i d0 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        __m128i d1 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16)));
+        __m128i d2 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 32)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 32)));
+        __m128i d3 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 48)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 48)));
+        __m128i any = _mm_or_si128(_mm_or_si128(d0, d1), _mm_or_si128(d2, d3));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xFFFF) return true;
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) return true;
+    }
+#endif
+    return std::memcmp(a + i, b + i, n - i) != 0;
+}
 
-    // Convert the image data to a format that can be used by OpenGL
-    glGenTextures(1, &imageData.textureID);
-    glBindTexture(GL_TEXTURE_2D, imageData.textureID);
+// Define a view of decoded pixel rows where they sit in memory, which may be a mapped file
+struct ImageView {
+    const unsigned char* pixels = nullptr; // first row in memory
+    int width = 0, height = 0;
+    size_t stride = 0;            // bytes from one row to the next in memory
+    int bytesPerPixel = 3;
+    GLenum format = GL_RGB;       // GL_RGB, GL_BGR, GL_RGBA or GL_BGRA
+    GLint internalFormat = GL_RGB;
+    bool topDown = false;         // the first row in memory is the top of the image
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, surface->w, surface->h, 0, GL_RGB, GL_UNSIGNED_BYTE,
-surface->pixels);
+    size_t rowBytes() const { return size_t(width) * bytesPerPixel; }
 
-    // Allocate memory for the image data buffer
-    imageData.pixels = (unsigned char*)malloc(surface->w * surface->h * sizeof(unsigned char));
+    // Function to get row y counted from the bottom, which is the order OpenGL expects
+    const unsigned char* row(int y) const { return pixels + size_t(topDown ? height - 1 - y : y) * stride; }
+};
 
-    // Copy the image pixels to the buffer
-    memcpy(imageData.pixels, surface->pixels, surface->w * surface->h * 3);
+// Define an image file reader. Uncompressed BMP files (24 or 32 bits per pixel) and raw files are memory-mapped
+// and their pixel rows are used in place, so loading costs no copy and the pages can be dropped by the kernel at
+// any time because they are backed by the file. Header fields are validated against the file size before any
+// row is exposed, and a file that fails validation is rejected. Anything else, such as RLE-compressed or
+// palettized BMP files, falls back to a streaming read through SDL into a buffer that is reused by the next open().
+// Raw files are a 16-byte header ("RAWI", then little-endian 32-bit width, height and channel count of 3 or 4)
+// followed by tightly packed RGB or RGBA rows, bottom row first.
+// A mapped file must not be truncated while it is open; replace it by renaming a new file over it instead.
+class ImageFile {
+public:
+    ImageFile() = default;
+    ~ImageFile() { close(); }
 
-    free(surface);
-    return imageData;
-}
+    ImageFile(const ImageFile&) = delete;
+    ImageFile& operator=(const ImageFile&) = delete;
+
+    // Function to open an image; returns false if the file is missing or not a valid image
+    bool open(const char* path) {
+        close();
+        Parse result = openMapped(path);
+        if (result == Parse::Unsupported) return openStreamed(path);
+        return result == Parse::Mapped;
+    }
+
+    // Function to release the mapping; the streaming buffer keeps its capacity
+    void close() {
+        if (mapping) munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+        image = ImageView();
+    }
+
+    const ImageView& view() const { return image; }
+    bool isMapped() const { return mapping != nullptr; }
+
+private:
+    // A file is mapped, needs the streaming decoder, or claims a mappable format but fails validation
+    enum class Parse { Mapped, Unsupported, Invalid };
+
+    static uint32_t readU32(const unsigned char* p) { return p[0] | p[1] << 8 | p[2] << 16 | uint32_t(p[3]) << 24; }
+    static uint16_t readU16(const unsigned char* p) { return uint16_t(p[0] | p[1] << 8); }
+
+    Parse openMapped(const char* path) {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return Parse::Unsupported;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < 16) {
+            ::close(fd);
+            return Parse::Unsupported;
+        }
+        size_t size = size_t(info.st_size);
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (p == MAP_FAILED) return Parse::Unsupported;
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(p);
+        Parse result = parseBmp(bytes, size);
+        if (result == Parse::Unsupported) result = parseRaw(bytes, size);
+        if (result != Parse::Mapped) {
+            munmap(p, size);
+            image = ImageView();
+            return result;
+        }
+        madvise(p, size, MADV_SEQUENTIAL);
+        mapping = p;
+        mappingSize = size;
+        return Parse::Mapped;
+    }
+
+    Parse parseBmp(const unsigned char* bytes, size_t size) {
+        if (size < 54 || bytes[0] != 'B' || bytes[1] != 'M') return Parse::Unsupported;
+        uint32_t pixelOffset = readU32(bytes + 10);
+        uint32_t headerSize = readU32(bytes + 14);
+        int32_t width = int32_t(readU32(bytes + 18));
+        int32_t height = int32_t(readU32(bytes + 22));
+        uint16_t planes = readU16(bytes + 26);
+        uint16_t bitsPerPixel = readU16(bytes + 28);
+        uint32_t compression = readU32(bytes + 30);
+        // Only uncompressed true-color images can be used in place
+        if (compression != 0 || (bitsPerPixel != 24 && bitsPerPixel != 32)) return Parse::Unsupported;
+        if (headerSize < 40 || planes != 1 || width <= 0 || width > 65536 || height == 0 || height > 65536 ||
+            height < -65536) {
+            return Parse::Invalid;
+        }
+
+        uint64_t rows = uint64_t(height < 0 ? -int64_t(height) : height);
+        uint64_t stride = (uint64_t(width) * bitsPerPixel + 31) / 32 * 4;
+        if (pixelOffset < 14 + headerSize || pixelOffset + stride * rows > size) return Parse::Invalid;
+
+        image.pixels = bytes + pixelOffset;
+        image.width = width;
+        image.height = int(rows);
+        image.stride = size_t(stride);
+        image.bytesPerPixel = bitsPerPixel / 8;
+        image.format = bitsPerPixel == 24 ? GL_BGR : GL_BGRA;
+        image.internalFormat = GL_RGB; // the fourth byte of a BI_RGB pixel is unused
+        image.topDown = height < 0;
+        return Parse::Mapped;
+    }
+
+    Parse parseRaw(const unsigned char* bytes, size_t size) {
+        if (std::memcmp(bytes, "RAWI", 4) != 0) return Parse::Unsupported;
+        uint32_t width = readU32(bytes + 4);
+        uint32_t height = readU32(bytes + 8);
+        uint32_t channels = readU32(bytes + 12);
+        if (width == 0 || height == 0 || width > 65536 || height > 65536 || (channels != 3 && channels != 4)) {
+            return Parse::Invalid;
+        }
+        uint64_t stride = uint64_t(width) * channels;
+        if (16 + stride * height > size) return Parse::Invalid;
 
-// Function to update the image data
-void updateImageData(ImageData* imageData) {
-    // Load a new image from file into the buffer
-    imageData->pixels = (unsigned char*)malloc(imageData->width * imageData->height * sizeof(unsigned char));
-    memcpy(imageData->pixels, loadImage("new_image.bmp").pixels, imageData->width * imageData->height * 3);
+        image.pixels = bytes + 16;
+        image.width = int(width);
+        image.height = int(height);
+        image.stride = size_t(stride);
+        image.bytesPerPixel = int(channels);
+        image.format = channels == 3 ? GL_RGB : GL_RGBA;
+        image.internalFormat = image.format;
+        image.topDown = false;
+        return Parse::Mapped;
+    }
+
+    bool openStreamed(const char* path) {
+        SDL_Surface* loaded = SDL_LoadBMP(path);
+        if (!loaded) return false;
+        SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGB24, 0);
+        SDL_FreeSurface(loaded);
+        if (!surface) return false;
+
+        size_t rowBytes = size_t(surface->w) * 3;
+        decoded.resize(rowBytes * surface->h);
+        const unsigned char* source = static_cast<const unsigned char*>(surface->pixels);
+        for (int y = 0; y < surface->h; ++y) {
+            std::memcpy(decoded.data() + y * rowBytes, source + size_t(y) * surface->pitch, rowBytes);
+        }
+        image.pixels = decoded.data();
+        image.width = surface->w;
+        image.height = surface->h;
+        image.stride = rowBytes;
+        image.bytesPerPixel = 3;
+        image.format = GL_RGB;
+        image.internalFormat = GL_RGB;
+        image.topDown = true; // SDL surfaces store the top row first
+        SDL_FreeSurface(surface);
+        return true;
+    }
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    std::vector<unsigned char> decoded;
+    ImageView image;
+};
+
+// Function to upload an image into the bound texture. Bottom-up rows whose stride OpenGL can describe are read
+// straight from where they are, e.g. the file mapping; only top-down images are first flipped into scratch memory.
+// With allocate set the texture storage is (re)specified, otherwise the existing storage is overwritten.
+void uploadImage(const ImageView& image, FrameAllocator& scratch, bool allocate) {
+    const unsigned char* pixels = image.pixels;
+    size_t stride = image.stride;
+    if (image.topDown || stride % image.bytesPerPixel != 0) {
+        unsigned char* flipped = scratch.allocateArray<unsigned char>(image.rowBytes() * image.height);
+        for (int y = 0; y < image.height; ++y) {
+            std::memcpy(flipped + y * image.rowBytes(), image.row(y), image.rowBytes());
+        }
+        pixels = flipped;
+        stride = image.rowBytes();
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, GLint(stride / image.bytesPerPixel));
+    if (allocate) {
+        glTexImage2D(GL_TEXTURE_2D, 0, image.internalFormat, image.width, image.height, 0, image.format,
+                     GL_UNSIGNED_BYTE, pixels);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, image.format, GL_UNSIGNED_BYTE, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
 
-    // Update the texture object to reference the new image data
+// Function to create the texture object for an image
+void createTexture(ImageData* imageData, const ImageView& image, FrameAllocator& scratch) {
+    glGenTextures(1, &imageData->textureID);
     glBindTexture(GL_TEXTURE_2D, imageData->textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, imageData->width, imageData->height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-imageData->pixels);
+    uploadImage(image, scratch, true);
+    imageData->width = image.width;
+    imageData->height = image.height;
+    imageData->internalFormat = image.internalFormat;
 }
 
+// Define an asynchronous texture reloader. A loader thread watches the image file with inotify; when the file is
+// rewritten it opens it with ImageFile (mapped in place, or decoded into a buffer reused between reloads) and
+// copies the rows, bottom row first, into a pixel buffer object that the render thread has mapped for it. Two
+// PBOs alternate, so the loader can fill one while the other is still being uploaded. The render thread only calls
+// update() once per frame: it unmaps a filled PBO and starts an asynchronous glTexSubImage2D from it into a second
+// texture, and once the fence for that upload has signalled it swaps the two textures, each together with the
+// size and internal format its storage was specified with. A frame never waits for the file system, the decoder
+// or the upload, so an update costs a few GL calls at most.
+// Only what changed is uploaded: the loader keeps a resident copy of the last image it published and compares the
+// new one against it in 64x64 tiles, then copies and uploads just the rectangles covering the changed tiles.
+class TextureReloader {
+public:
+    // Takes ownership of the texture in imageData; use texture() to get the current one from now on
+    TextureReloader(const char* path, ImageData& imageData)
+        : path(path), front{imageData.textureID, imageData.width, imageData.height, imageData.internalFormat} {
+        glGenTextures(1, &back.id);
+        for (Slot& slot : slots) {
+            glGenBuffers(1, &slot.pbo);
+            slot.capacity = size_t(imageData.width) * imageData.height * 3;
+        }
+        loader = std::thread(&TextureReloader::watch, this);
+    }
+
+    ~TextureReloader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        slotChanged.notify_all();
+        loader.join();
+
+        for (Slot& slot : slots) {
+            if (slot.mapping) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            if (slot.fence) glDeleteSync(slot.fence);
+            glDeleteBuffers(1, &slot.pbo);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteTextures(1, &front.id);
+        glDeleteTextures(1, &back.id);
+    }
+
+    TextureReloader(const TextureReloader&) = delete;
+    TextureReloader& operator=(const TextureReloader&) = delete;
+
+    // Function to advance pending reloads; call once per frame on the thread that owns the GL context
+    void update() {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool uploading = false;
+        bool mapped = false;
+        for (Slot& slot : slots) {
+            if (slot.state == SlotState::Uploading) {
+                GLenum status = glClientWaitSync(slot.fence, 0, 0);
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                    glDeleteSync(slot.fence);
+                    slot.fence = nullptr;
+                    slot.state = SlotState::Free;
+                    std::swap(front, back);
+                    ++reloads;
+                } else {
+                    uploading = true;
+                }
+            } else if (slot.state == SlotState::TooSmall) {
+                unmap(slot);
+                slot.capacity = slot.requiredBytes;
+                slot.state = SlotState::Free;
+            }
+        }
+
+        for (Slot& slot : slots) {
+            if (slot.state == SlotState::Filled && !uploading) {
+                startUpload(slot);
+                uploading = true;
+            }
+            mapped = mapped || slot.state == SlotState::Mapped || slot.state == SlotState::Filling;
+        }
+
+        // Keep one PBO mapped so the loader always has somewhere to put the next image. A PBO without storage
+        // (there was no initial image to size it) cannot be mapped; it is handed over empty, the loader reports
+        // it TooSmall, and it is reallocated above for the image that is waiting.
+        if (!mapped) {
+            for (Slot& slot : slots) {
+                if (slot.state != SlotState::Free) continue;
+                if (slot.capacity > 0) {
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+                    glBufferData(GL_PIXEL_UNPACK_BUFFER, slot.capacity, nullptr, GL_STREAM_DRAW);
+                    slot.mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slot.capacity,
+                                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                }
+                if (slot.mapping || slot.capacity == 0) {
+                    slot.state = SlotState::Mapped;
+                    slotChanged.notify_one();
+                }
+                break;
+            }
+        }
+    }
+
+    GLuint texture() const { return front.id; }
+    size_t reloadCount() const { return reloads; }
+    size_t bytesUploaded() const { return uploadedBytes; }
+
+private:
+    // Free -> Mapped (by the render thread) -> Filling -> Filled (by the loader) -> Uploading -> Free
+    // A mapping too small for the image goes Filling -> TooSmall and is reallocated by the render thread.
+    enum class SlotState { Free, Mapped, Filling, Filled, TooSmall, Uploading };
+
+    static const int TILE_SIZE = 64;
+    static const size_t MAX_UPLOAD_RECTS = 16; // beyond this the bounding box is uploaded in one call
+
+    struct Rect {
+        int x, y, width, height;
+    };
+
+    struct Texture {
+        GLuint id = 0;
+        int width = 0, height = 0;
+        GLint internalFormat = 0; // 0 until storage has been specified
+    };
+
+    struct Slot {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        void* mapping = nullptr;
+        SlotState state = SlotState::Free;
+        int width = 0, height = 0;
+        int bytesPerPixel = 3;
+        GLenum format = GL_RGB;
+        GLint internalFormat = GL_RGB;
+        std::vector<Rect> rects; // parts of the image that were written to the PBO and need uploading
+        size_t requiredBytes = 0;
+        GLsync fence = nullptr;
+    };
+
+    static void unmap(Slot& slot) {
+        if (!slot.mapping) return;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        slot.mapping = nullptr;
+    }
+
+    void startUpload(Slot& slot) {
+        unmap(slot);
+        glBindTexture(GL_TEXTURE_2D, back.id);
+        if (back.width != slot.width || back.height != slot.height || back.internalFormat != slot.internalFormat) {
+            glTexImage2D(GL_TEXTURE_2D, 0, slot.internalFormat, slot.width, slot.height, 0, slot.format,
+                         GL_UNSIGNED_BYTE, nullptr);
+            back.width = slot.width;
+            back.height = slot.height;
+            back.internalFormat = slot.internalFormat;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, slot.width);
+        for (const Rect& rect : slot.rects) {
+            size_t offset = (size_t(rect.y) * slot.width + rect.x) * slot.bytesPerPixel;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, slot.format, GL_UNSIGNED_BYTE,
+                            reinterpret_cast<const void*>(offset));
+            uploadedBytes += size_t(rect.width) * rect.height * slot.bytesPerPixel;
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, front.id);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.state = SlotState::Uploading;
+    }
+
+    // Loader thread: wait for the file to be rewritten, then decode and publish it
+    void watch() {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return;
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        // Watch the directory: editors often replace a file by renaming a new one over it
+        inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+        alignas(inotify_event) char events[4096];
+        while (!stopping) {
+            pollfd request = {fd, POLLIN, 0};
+            if (poll(&request, 1, 100) <= 0) continue;
+
+            // Collapse a burst of events into one reload
+            bool changed = false;
+            ssize_t length;
+            while ((length = read(fd, events, sizeof(events))) > 0) {
+                for (char* p = events; p < events + length;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                    if (event->len > 0 && name == event->name) changed = true;
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+            if (changed && source.open(path.c_str())) {
+                publish(source.view());
+                source.close(); // do not hold the mapping while the file may be rewritten
+            }
+        }
+        close(fd);
+    }
+
+    // Function to compare an image with the resident copy and collect in dirtyRects what must be uploaded to
+    // the texture that will receive it. Uploads finish in the order they are published and each one swaps the
+    // textures, so publish number n always lands in the texture that received publish n - 2; that texture needs
+    // every tile changed since then. Returns false if nothing changed since the last publish.
+    bool findDirtyRects(const ImageView& image, uint32_t version) {
+        size_t rowBytes = image.rowBytes();
+        if (image.width != residentWidth || image.height != residentHeight || image.format != residentFormat ||
+            image.bytesPerPixel != residentBytesPerPixel) {
+            residentWidth = image.width;
+            residentHeight = image.height;
+            residentFormat = image.format;
+            residentBytesPerPixel = image.bytesPerPixel;
+            resident.resize(rowBytes * image.height);
+            tilesX = (image.width + TILE_SIZE - 1) / TILE_SIZE;
+            tilesY = (image.height + TILE_SIZE - 1) / TILE_SIZE;
+            tileVersions.assign(size_t(tilesX) * tilesY, version);
+            textureVersions[0] = textureVersions[1] = 0; // both textures need a full upload
+        } else {
+            bool changed = false;
+            size_t tileBytes = size_t(TILE_SIZE) * image.bytesPerPixel;
+            for (int y = 0; y < image.height; ++y) {
+                const unsigned char* incoming = image.row(y);
+                const unsigned char* current = resident.data() + y * rowBytes;
+                uint32_t* versions = tileVersions.data() + size_t(y / TILE_SIZE) * tilesX;
+                for (int tx = 0; tx < tilesX; ++tx) {
+                    if (versions[tx] == version) continue;
+                    size_t offset = tx * tileBytes;
+                    if (bytesDiffer(incoming + offset, current + offset, std::min(tileBytes, rowBytes - offset))) {
+                        versions[tx] = version;
+                        changed = true;
+                    }
+                }
+            }
+            if (!changed) return false;
+        }
+
+        dirtyRects.clear();
+        uint32_t since = textureVersions[version & 1];
+        if (since == 0) {
+            dirtyRects.push_back({0, 0, image.width, image.height});
+            return true;
+        }
+
+        // Join runs of dirty tiles in each tile row, and extend a rectangle from the row below when a run spans
+        // exactly the same columns
+        openRects.clear();
+        for (int ty = 0; ty < tilesY; ++ty) {
+            nextOpenRects.clear();
+            const uint32_t* versions = tileVersions.data() + size_t(ty) * tilesX;
+            for (int tx = 0; tx < tilesX;) {
+                if (versions[tx] <= since) {
+                    ++tx;
+                    continue;
+                }
+                int runStart = tx;
+                while (tx < tilesX && versions[tx] > since) ++tx;
+
+                size_t index = dirtyRects.size();
+                for (size_t open : openRects) {
+                    if (dirtyRects[open].x == runStart && dirtyRects[open].width == tx - runStart) index = open;
+                }
+                if (index == dirtyRects.size()) {
+                    dirtyRects.push_back({runStart, ty, tx - runStart, 0});
+                }
+                dirtyRects[index].height += 1;
+                nextOpenRects.push_back(index);
+            }
+            openRects.swap(nextOpenRects);
+        }
+
+        if (dirtyRects.size() > MAX_UPLOAD_RECTS) {
+            Rect bounds = dirtyRects[0];
+            for (const Rect& r : dirtyRects) {
+                int right = std::max(bounds.x + bounds.width, r.x + r.width);
+                int top = std::max(bounds.y + bounds.height, r.y + r.height);
+                bounds.x = std::min(bounds.x, r.x);
+                bounds.y = std::min(bounds.y, r.y);
+                bounds.width = right - bounds.x;
+                bounds.height = top - bounds.y;
+            }
+            dirtyRects.assign(1, bounds);
+        }
+
+        // Convert from tiles to pixels, clipping the last row and column of tiles to the image
+        for (Rect& r : dirtyRects) {
+            r.x *= TILE_SIZE;
+            r.y *= TILE_SIZE;
+            r.width = std::min(r.width * TILE_SIZE, image.width - r.x);
+            r.height = std::min(r.height * TILE_SIZE, image.height - r.y);
+        }
+        return true;
+    }
+
+    // Function to copy the changed parts of an image into a mapped PBO, bottom row first, and hand it to the
+    // render thread. The PBO mirrors the layout of the whole image; parts outside the rectangles are left unset.
+    void publish(const ImageView& image) {
+        uint32_t version = publishedVersions + 1;
+        if (!findDirtyRects(image, version)) return;
+
+        size_t bytes = image.rowBytes() * image.height;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            Slot* slot = nullptr;
+            for (Slot& s : slots) {
+                if (s.state == SlotState::Mapped) slot = &s;
+            }
+            if (!slot) {
+                slotChanged.wait(lock);
+                continue;
+            }
+            if (slot->capacity < bytes) {
+                slot->requiredBytes = bytes;
+                slot->state = SlotState::TooSmall;
+                continue;
+            }
+
+            slot->state = SlotState::Filling;
+            lock.unlock();
+            unsigned char* target = static_cast<unsigned char*>(slot->mapping);
+            size_t rowBytes = image.rowBytes();
+            for (const Rect& rect : dirtyRects) {
+                size_t offset = size_t(rect.x) * image.bytesPerPixel;
+                size_t length = size_t(rect.width) * image.bytesPerPixel;
+                for (int y = rect.y; y < rect.y + rect.height; ++y) {
+                    std::memcpy(target + y * rowBytes + offset, image.row(y) + offset, length);
+                    std::memcpy(resident.data() + y * rowBytes + offset, image.row(y) + offset, length);
+                }
+            }
+            publishedVersions = version;
+            textureVersions[version & 1] = version;
+
+            lock.lock();
+            slot->width = image.width;
+            slot->height = image.height;
+            slot->bytesPerPixel = image.bytesPerPixel;
+            slot->format = image.format;
+            slot->internalFormat = image.internalFormat;
+            slot->rects = dirtyRects;
+            slot->state = SlotState::Filled;
+            return;
+        }
+    }
+
+    std::string path;
+    Texture front, back; // the texture being drawn, and the one that receives the next upload
+    Slot slots[2];
+    size_t reloads = 0;
+    size_t uploadedBytes = 0;
+
+    // Used only by the loader thread
+    ImageFile source;
+    std::vector<unsigned char> resident; // last published image, bottom row first
+    int residentWidth = 0, residentHeight = 0, residentBytesPerPixel = 0;
+    GLenum residentFormat = 0;
+    int tilesX = 0, tilesY = 0;
+    std::vector<uint32_t> tileVersions; // publish number that last changed each tile
+    uint32_t publishedVersions = 0;
+    uint32_t textureVersions[2] = {0, 0}; // publish number each texture holds, by publish parity; 0 = unknown
+    std::vector<Rect> dirtyRects;
+    std::vector<size_t> openRects, nextOpenRects; // rectangles that reach the current tile row
+
+    std::mutex mutex;
+    std::condition_variable slotChanged;
+    std::atomic<bool> stopping{false};
+    std::thread loader;
+};
+
 int main() {
     // Initialize SDL and OpenGL
     SDL_Init(SDL_INIT_VIDEO);
     glewInit();
 
-    // Load the initial image data
+    // Scratch memory for per-frame temporary buffers such as the initial image
+    FrameAllocator frameAllocator(16 * 1024 * 1024);
+
+    // Load the initial image; its rows are uploaded straight from the file mapping
     ImageData imageData;
-    imageData = loadImage("initial_image.bmp");
+    {
+        ImageFile initialImage;
+        if (initialImage.open("initial_image.bmp")) createTexture(&imageData, initialImage.view(), frameAllocator);
+    }
+
+    // Reload the texture in the background whenever new_image.bmp is rewritten
+    TextureReloader textureReloader("new_image.bmp", imageData);
 
     // Create a 3D model and bind the texture object to it
     GLuint modelID;
@@ -57,16 +656,13 @@ int main() {
     glBindBuffer(GL_ARRAY_BUFFER, modelID);
     glBufferData(GL_ARRAY_BUFFER, 1024 * 1024, NULL, GL_STATIC_DRAW);
 
-    glBindTexture(GL_TEXTURE_2D, imageData.textureID);
-
     // Main loop
     while (!SDL_QUIT) {
         SDL_Delay(16); // Cap at 60 FPS
 
-        // Update the image data every 10 frames
-        if (SDL_GetTicks() % 1000 == 0) {
-            updateImageData(&imageData);
-        }
+        // Pick up a reloaded texture once its upload has finished
+        textureReloader.update();
+        glBindTexture(GL_TEXTURE_2D, textureReloader.texture());
 
         // Clear the screen and draw the model
         glClear(GL_COLOR_BUFFER_BIT);
@@ -76,14 +672,30 @@ int main() {
 
         // Swap the buffers and display the frame
         SDL_GL_SwapWindow(window);
+        frameAllocator.endFrame();
     }
 
     return 0;
 }
 /*
-In this example, we load an image file into a buffer using `loadImage()`. We then create a texture object that
-references the loaded image data buffer. In the main loop, we update the image data every 10 frames using
-`updateImageData()`, which loads a new image from file and updates the texture object to reference it.
+In this example, images are read with `ImageFile`. Uncompressed BMP and raw files are memory-mapped and, after
+their headers have been checked against the file size, their pixel rows are handed to OpenGL where they lie:
+`uploadImage()` describes the row stride with `GL_UNPACK_ROW_LENGTH`, and BMP's bottom-up row order is already
+the order OpenGL expects, so loading an image copies nothing. Only top-down images are flipped, into memory from a
+`FrameAllocator` that is rewound every frame. Compressed files fall back to a streaming read through SDL.
+
+Updates to the image are handled by `TextureReloader`. Its loader thread is woken by inotify when `new_image.bmp`
+is rewritten, opens the file with `ImageFile`, and copies the rows into one of two pixel buffer objects that the
+render thread keeps mapped for it. Once per frame, `update()` starts an asynchronous upload from a filled PBO into
+a second texture and, when the fence for that upload has signalled, swaps it with the texture being drawn. The
+render thread therefore never reads the file, decodes, copies pixels or waits for the GPU, and the texture being
+sampled is never modified mid-frame.
+
+Most live-updated textures change only a little between updates, so the loader diffs every new image against a
+resident copy in 64x64 tiles with SSE2 compares. Runs of changed tiles are merged into rectangles (falling back
+to their bounding box when there are many), and only those rectangles are copied into the PBO and uploaded with
+`glTexSubImage2D`. Because the two textures alternate, each upload covers the tiles changed since the texture
+receiving it was last updated, not just those changed since the previous image.
 
 Note that this is just a simple example, and you may need to modify it to suit your specific use case. For
 example, you may want to add error checking or handling for cases where the image loading fails.
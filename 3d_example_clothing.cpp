@@ -67,21 +67,37 @@ private:
     float height = 18.0f;
 };
 ```
+**Slot Map**
+
+The character stores its parts in slot maps: each part type lives in one contiguous array, and outfits are
+referred to by generational handles rather than by pointers to objects created with `new`. `SlotMap` and
+`SlotHandle` live in slot_map.h, which the other slot map examples include as well.
+```cpp
+#include "slot_map.h"
+```
 **Character Class**
 ```cpp
 class Character {
 public:
-    std::vector<Clothing*> outfits;
+    SlotHandle<ShirtPart> addOutfit(const ShirtPart& part) { return shirts.insert(part); }
+    SlotHandle<PantsPart> addOutfit(const PantsPart& part) { return pants.insert(part); }
+    SlotHandle<JacketPart> addOutfit(const JacketPart& part) { return jackets.insert(part); }
 
-    void addOutfit(Clothing* outfit) { outfits.push_back(outfit); }
+    bool removeOutfit(SlotHandle<ShirtPart> handle) { return shirts.erase(handle); }
+    bool removeOutfit(SlotHandle<PantsPart> handle) { return pants.erase(handle); }
+    bool removeOutfit(SlotHandle<JacketPart> handle) { return jackets.erase(handle); }
 
+    // Render each part type with a linear scan over its array; no virtual call or pointer chase per part
     void render() {
-        for (auto& outfit : outfits) {
-            outfit->render();
-        }
+        for (ShirtPart& part : shirts) part.render();
+        for (PantsPart& part : pants) part.render();
+        for (JacketPart& part : jackets) part.render();
     }
 
-    virtual ~Character() {}
+private:
+    SlotMap<ShirtPart> shirts;
+    SlotMap<PantsPart> pants;
+    SlotMap<JacketPart> jackets;
 };
 ```
 **Example Usage**
@@ -90,19 +106,18 @@ int main() {
     // Create a character
     Character character;
 
-    // Add an outfit to the character
-    Clothing* shirt = new ShirtPart(0, 0, -10.0f);
-    clothing->addOutfit(shirt);
-
-    Clothing* pants = new PantsPart(-5.0f, 0, -10.0f);
-    clothing->addOutfit(pants);
-
-    Clothing* jacket = new JacketPart(5.0f, 0, -10.0f);
-    clothing->addOutfit(jacket);
+    // Add an outfit to the character; the character owns the parts, the caller only keeps handles
+    SlotHandle<ShirtPart> shirt = character.addOutfit(ShirtPart(0, 0, -10.0f));
+    character.addOutfit(PantsPart(-5.0f, 0, -10.0f));
+    character.addOutfit(JacketPart(5.0f, 0, -10.0f));
 
     // Render the character
     character.render();
 
+    // Taking the shirt off invalidates its handle; removing it a second time is detected and ignored
+    character.removeOutfit(shirt);
+    character.removeOutfit(shirt);
+
     return 0;
 }
 /*
@@ -5,6 +5,9 @@ OpenGL or SDL. Here's a simplified example using OpenGL:
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 
 struct Clothing {
     struct BodyPart *bodyParts;
@@ -17,8 +20,46 @@ struct BodyPart {
     float scale, rotationX, rotationY;
 };
 
+/* Cloth of one garment. Particles and constraints are stored as one array per attribute (structure of arrays).
+   Constraints are sorted by color: constraints colorStart[c] to colorStart[c + 1] - 1 share no particle. */
+struct Cloth {
+    int columns, rows, numParticles;
+    float *x, *y, *z;
+    float *prevX, *prevY, *prevZ; // positions at the start of the substep
+    float *vx, *vy, *vz;
+    float *invMass;               // 0 for the top row, which is pinned to the body part
+    float *pinnedFromX, *pinnedFromY;
+
+    int numConstraints, numColors;
+    int *first, *second;
+    float *restLength, *compliance;
+    int *colorStart;
+
+    int numTriangles;
+    int *triangles;
+};
+
+/* Collision proxy: the body under a garment, which cloth must not enter. It is a capsule of the given radius
+   around the segment from a to b in world space; a sphere is a capsule whose ends coincide. */
+struct BodyProxy {
+    float a[3], b[3];
+    float radius;
+};
+
+/* Spatial hash of the body proxies. Every cell that a proxy's bounding box overlaps adds an entry to the cell's
+   bucket; bucket b holds the proxies entries[bucketStart[b]] to entries[bucketStart[b + 1] - 1]. */
+struct ProxyHash {
+    const struct BodyProxy *proxies;
+    int numBuckets; // a power of two
+    int numEntries, capacity;
+    int *bucketStart, *entries, *entryBucket;
+};
+
 struct Clothing {
     struct BodyPart bodyParts[100]; // Replace with a dynamic array
+    struct Cloth garments[100];     // cloth hanging from each body part
+    struct BodyProxy proxies[100];  // body under each body part
+    struct ProxyHash proxyHash;
     int numBodyParts;
 };
 ```
@@ -40,6 +81,417 @@ physics calculations.
 ```c
 #include <GL/glew.h>
 
+/* Settings of the cloth solver. Every frame is split into substeps of a single constraint iteration each
+   ("small steps" XPBD), which makes cloth stiffer than spending the same work on iterations of one large step. */
+#define CLOTH_SUBSTEPS 8
+#define GRAVITY (-9.8f)
+#define CLOTH_MASS 1.0f           // mass of a whole garment, spread evenly over its free particles
+#define STRETCH_COMPLIANCE 0.0f   // inverse stiffness of the edge constraints; 0 is inextensible
+#define BENDING_COMPLIANCE 1e-3f  // inverse stiffness of the bending constraints
+#define CLOTH_DAMPING 0.5f        // fraction of a particle's velocity lost per second
+#define CLOTH_THICKNESS 0.02f     // distance that cloth keeps from the body proxies
+#define COLLISION_CELL_SIZE 0.25f // edge length of the spatial hash's cells
+#define COLLISION_BUCKETS 1024    // buckets of the spatial hash; a power of two
+
+void clothFree(struct Cloth *cloth) {
+    float **floats[] = {&cloth->x, &cloth->y, &cloth->z, &cloth->prevX, &cloth->prevY, &cloth->prevZ,
+                        &cloth->vx, &cloth->vy, &cloth->vz, &cloth->invMass, &cloth->pinnedFromX,
+                        &cloth->pinnedFromY, &cloth->restLength, &cloth->compliance};
+    int **ints[] = {&cloth->first, &cloth->second, &cloth->colorStart, &cloth->triangles};
+    for (size_t i = 0; i < sizeof(floats) / sizeof(floats[0]); i++) {
+        free(*floats[i]);
+        *floats[i] = NULL;
+    }
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        free(*ints[i]);
+        *ints[i] = NULL;
+    }
+    cloth->numParticles = cloth->numConstraints = cloth->numColors = cloth->numTriangles = 0;
+}
+
+struct EdgeUse {
+    int lower, higher, opposite;
+};
+
+static int compareEdgeUses(const void *a, const void *b) {
+    const struct EdgeUse *l = a, *r = b;
+    if (l->lower != r->lower) return l->lower < r->lower ? -1 : 1;
+    return (l->higher > r->higher) - (l->higher < r->higher);
+}
+
+static void addConstraint(struct Cloth *cloth, int a, int b, float compliance) {
+    float dx = cloth->x[a] - cloth->x[b], dy = cloth->y[a] - cloth->y[b], dz = cloth->z[a] - cloth->z[b];
+    int k = cloth->numConstraints++;
+    cloth->first[k] = a;
+    cloth->second[k] = b;
+    cloth->restLength[k] = sqrtf(dx * dx + dy * dy + dz * dz);
+    cloth->compliance[k] = compliance;
+}
+
+/* Function to derive the constraints from the triangles: a distance constraint along every edge, and a softer
+   bending constraint between the opposite corners of every two triangles that share an edge. Returns -1 if
+   memory runs out. */
+static int buildConstraints(struct Cloth *cloth) {
+    int numUses = 3 * cloth->numTriangles;
+    struct EdgeUse *uses = malloc(sizeof(struct EdgeUse) * (numUses > 0 ? numUses : 1));
+    cloth->first = malloc(sizeof(int) * 2 * (numUses + 1));
+    cloth->second = malloc(sizeof(int) * 2 * (numUses + 1));
+    cloth->restLength = malloc(sizeof(float) * 2 * (numUses + 1));
+    cloth->compliance = malloc(sizeof(float) * 2 * (numUses + 1));
+    if (!uses || !cloth->first || !cloth->second || !cloth->restLength || !cloth->compliance) {
+        free(uses);
+        return -1;
+    }
+
+    for (int t = 0; t < cloth->numTriangles; t++) {
+        const int *corner = &cloth->triangles[3 * t];
+        for (int k = 0; k < 3; k++) {
+            int from = corner[k], to = corner[(k + 1) % 3];
+            struct EdgeUse use = {from < to ? from : to, from < to ? to : from, corner[(k + 2) % 3]};
+            uses[3 * t + k] = use;
+        }
+    }
+    qsort(uses, numUses, sizeof(struct EdgeUse), compareEdgeUses);
+
+    cloth->numConstraints = 0;
+    for (int i = 0; i < numUses;) {
+        int j = i + 1;
+        while (j < numUses && uses[j].lower == uses[i].lower && uses[j].higher == uses[i].higher) j++;
+        addConstraint(cloth, uses[i].lower, uses[i].higher, STRETCH_COMPLIANCE);
+        if (j - i == 2 && uses[i].opposite != uses[i + 1].opposite) {
+            addConstraint(cloth, uses[i].opposite, uses[i + 1].opposite, BENDING_COMPLIANCE);
+        }
+        i = j;
+    }
+    free(uses);
+    return 0;
+}
+
+/* Function to sort the constraints into colors so that no particle appears twice within a color. Then the
+   constraints of a color can be solved at the same time, by several threads and SIMD lanes, without atomics.
+   Greedy coloring gives each constraint the lowest color that neither of its particles has used yet; colors are
+   handed out 64 at a time with one bit mask per particle. Returns -1 if memory runs out. */
+static int colorConstraints(struct Cloth *cloth) {
+    int n = cloth->numConstraints;
+    int *color = malloc(sizeof(int) * (n + 1));
+    uint64_t *used = malloc(sizeof(uint64_t) * cloth->numParticles);
+    int *sortedFirst = malloc(sizeof(int) * (n + 1)), *sortedSecond = malloc(sizeof(int) * (n + 1));
+    float *sortedRest = malloc(sizeof(float) * (n + 1)), *sortedCompliance = malloc(sizeof(float) * (n + 1));
+    if (!color || !used || !sortedFirst || !sortedSecond || !sortedRest || !sortedCompliance) {
+        free(color);
+        free(used);
+        free(sortedFirst);
+        free(sortedSecond);
+        free(sortedRest);
+        free(sortedCompliance);
+        return -1;
+    }
+
+    cloth->numColors = 0;
+    for (int k = 0; k < n; k++) color[k] = -1;
+    for (int remaining = n, base = 0; remaining > 0; base += 64) {
+        for (int i = 0; i < cloth->numParticles; i++) used[i] = 0;
+        for (int k = 0; k < n; k++) {
+            if (color[k] >= 0) continue;
+            uint64_t available = ~(used[cloth->first[k]] | used[cloth->second[k]]);
+            if (available == 0) continue;
+            int bit = 0;
+            while (!(available & ((uint64_t)1 << bit))) bit++;
+            color[k] = base + bit;
+            used[cloth->first[k]] |= (uint64_t)1 << bit;
+            used[cloth->second[k]] |= (uint64_t)1 << bit;
+            if (color[k] + 1 > cloth->numColors) cloth->numColors = color[k] + 1;
+            remaining--;
+        }
+    }
+
+    /* Counting sort by color, which keeps the constraints of a color in their original order */
+    cloth->colorStart = calloc(cloth->numColors + 1, sizeof(int));
+    if (!cloth->colorStart) {
+        free(color);
+        free(used);
+        free(sortedFirst);
+        free(sortedSecond);
+        free(sortedRest);
+        free(sortedCompliance);
+        return -1;
+    }
+    for (int k = 0; k < n; k++) cloth->colorStart[color[k] + 1]++;
+    for (int c = 0; c < cloth->numColors; c++) cloth->colorStart[c + 1] += cloth->colorStart[c];
+    for (int k = 0; k < n; k++) {
+        int to = cloth->colorStart[color[k]]++;
+        sortedFirst[to] = cloth->first[k];
+        sortedSecond[to] = cloth->second[k];
+        sortedRest[to] = cloth->restLength[k];
+        sortedCompliance[to] = cloth->compliance[k];
+    }
+    for (int c = cloth->numColors; c > 0; c--) cloth->colorStart[c] = cloth->colorStart[c - 1];
+    cloth->colorStart[0] = 0;
+
+    free(cloth->first);
+    free(cloth->second);
+    free(cloth->restLength);
+    free(cloth->compliance);
+    cloth->first = sortedFirst;
+    cloth->second = sortedSecond;
+    cloth->restLength = sortedRest;
+    cloth->compliance = sortedCompliance;
+    free(color);
+    free(used);
+    return 0;
+}
+
+/* Function to make the cloth of a body part: a grid of columns x rows particles over the body part's quad,
+   hanging from its top row. A grid needs at least 2 x 2 particles to span the quad, so fewer are raised to that.
+   Returns 0, or -1 if memory runs out, in which case the cloth is left empty. */
+int clothInitGrid(struct Cloth *cloth, const struct BodyPart *bodyPart, int columns, int rows) {
+    if (columns < 2) columns = 2;
+    if (rows < 2) rows = 2;
+    memset(cloth, 0, sizeof(*cloth));
+    cloth->columns = columns;
+    cloth->rows = rows;
+    cloth->numParticles = columns * rows;
+    float **floats[] = {&cloth->x, &cloth->y, &cloth->z, &cloth->prevX, &cloth->prevY, &cloth->prevZ,
+                        &cloth->vx, &cloth->vy, &cloth->vz, &cloth->invMass};
+    for (size_t i = 0; i < sizeof(floats) / sizeof(floats[0]); i++) {
+        *floats[i] = calloc(cloth->numParticles, sizeof(float));
+        if (!*floats[i]) {
+            clothFree(cloth);
+            return -1;
+        }
+    }
+    cloth->pinnedFromX = calloc(columns, sizeof(float));
+    cloth->pinnedFromY = calloc(columns, sizeof(float));
+    cloth->numTriangles = 2 * (columns - 1) * (rows - 1);
+    cloth->triangles = malloc(sizeof(int) * 3 * (cloth->numTriangles > 0 ? cloth->numTriangles : 1));
+    if (!cloth->pinnedFromX || !cloth->pinnedFromY || !cloth->triangles) {
+        clothFree(cloth);
+        return -1;
+    }
+
+    float particleMass = CLOTH_MASS / (columns * (rows - 1));
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < columns; c++) {
+            int i = r * columns + c;
+            cloth->x[i] = cloth->prevX[i] = bodyPart->x + bodyPart->scale * c / (columns - 1);
+            cloth->y[i] = cloth->prevY[i] = bodyPart->y + bodyPart->scale * (1.0f - (float)r / (rows - 1));
+            cloth->z[i] = cloth->prevZ[i] = 1.0f;
+            cloth->invMass[i] = r == 0 ? 0.0f : 1.0f / particleMass;
+        }
+    }
+    int *triangle = cloth->triangles;
+    for (int r = 0; r + 1 < rows; r++) {
+        for (int c = 0; c + 1 < columns; c++) {
+            int a = r * columns + c, b = a + columns;
+            int corners[6] = {a, b, a + 1, a + 1, b, b + 1};
+            memcpy(triangle, corners, sizeof(corners));
+            triangle += 6;
+        }
+    }
+    if (buildConstraints(cloth) != 0 || colorConstraints(cloth) != 0) {
+        clothFree(cloth);
+        return -1;
+    }
+    return 0;
+}
+
+/* Function to find the spatial hash cell that contains a coordinate */
+static inline int collisionCell(float coordinate) { return (int)floorf(coordinate / COLLISION_CELL_SIZE); }
+
+/* Function to map a cell to one of numBuckets buckets. Distinct cells may share a bucket; that only costs a few
+   extra proxy tests. */
+static inline int collisionBucket(int cx, int cy, int cz, int numBuckets) {
+    return (int)((((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u) ^ ((uint32_t)cz * 83492791u)) &
+                 (uint32_t)(numBuckets - 1));
+}
+
+void proxyHashFree(struct ProxyHash *hash) {
+    free(hash->bucketStart);
+    free(hash->entries);
+    free(hash->entryBucket);
+    memset(hash, 0, sizeof(*hash));
+}
+
+/* Function to bin the proxies into the spatial hash with a counting sort. The proxies stay put during a frame,
+   so this runs once per frame and every substep only looks particles up. A proxy is binned with the radius that
+   pushOutOfProxy() uses, widened by the cloth's thickness, so every cell where it pushes a particle holds it.
+   Returns -1 if memory runs out, in which case the hash is left empty and cloth does not collide. */
+int proxyHashBuild(struct ProxyHash *hash, const struct BodyProxy *proxies, int numProxies) {
+    hash->proxies = proxies;
+    hash->numBuckets = COLLISION_BUCKETS;
+    hash->numEntries = 0;
+    if (!hash->bucketStart) hash->bucketStart = malloc(sizeof(int) * (COLLISION_BUCKETS + 1));
+    if (!hash->bucketStart) return -1;
+
+    for (int pass = 0; pass < 2; pass++) {
+        /* The first pass counts the cells to size the arrays, the second records each cell's bucket */
+        int n = 0;
+        for (int i = 0; i < numProxies; i++) {
+            const struct BodyProxy *proxy = &proxies[i];
+            float radius = proxy->radius + CLOTH_THICKNESS;
+            int low[3], high[3];
+            for (int axis = 0; axis < 3; axis++) {
+                low[axis] = collisionCell(fminf(proxy->a[axis], proxy->b[axis]) - radius);
+                high[axis] = collisionCell(fmaxf(proxy->a[axis], proxy->b[axis]) + radius);
+            }
+            for (int cx = low[0]; cx <= high[0]; cx++) {
+                for (int cy = low[1]; cy <= high[1]; cy++) {
+                    for (int cz = low[2]; cz <= high[2]; cz++, n++) {
+                        if (pass == 0) continue;
+                        hash->entryBucket[n] = collisionBucket(cx, cy, cz, COLLISION_BUCKETS);
+                        hash->entries[n] = i;
+                    }
+                }
+            }
+        }
+        if (pass == 0 && n > hash->capacity) {
+            int *entries = realloc(hash->entries, sizeof(int) * n);
+            if (entries) hash->entries = entries;
+            int *entryBucket = realloc(hash->entryBucket, sizeof(int) * n);
+            if (entryBucket) hash->entryBucket = entryBucket;
+            if (!entries || !entryBucket) return -1;
+            hash->capacity = n;
+        }
+        hash->numEntries = n;
+    }
+
+    /* Counting sort by bucket: the entries are copied aside and scattered back in bucket order */
+    int *counts = hash->bucketStart;
+    memset(counts, 0, sizeof(int) * (COLLISION_BUCKETS + 1));
+    for (int e = 0; e < hash->numEntries; e++) counts[hash->entryBucket[e] + 1]++;
+    for (int b = 0; b < COLLISION_BUCKETS; b++) counts[b + 1] += counts[b];
+    int *unsorted = malloc(sizeof(int) * (hash->numEntries > 0 ? hash->numEntries : 1));
+    if (!unsorted) {
+        hash->numEntries = 0;
+        return -1;
+    }
+    memcpy(unsorted, hash->entries, sizeof(int) * hash->numEntries);
+    for (int e = 0; e < hash->numEntries; e++) hash->entries[counts[hash->entryBucket[e]]++] = unsorted[e];
+    for (int b = COLLISION_BUCKETS; b > 0; b--) counts[b] = counts[b - 1];
+    counts[0] = 0;
+    free(unsorted);
+    return 0;
+}
+
+/* Function to move a particle that is inside a proxy to the proxy's surface, away from the closest point of the
+   proxy's segment. The proxy's radius is widened by the cloth's thickness. */
+static inline void pushOutOfProxy(const struct BodyProxy *proxy, float *x, float *y, float *z) {
+    float abx = proxy->b[0] - proxy->a[0], aby = proxy->b[1] - proxy->a[1], abz = proxy->b[2] - proxy->a[2];
+    float apx = *x - proxy->a[0], apy = *y - proxy->a[1], apz = *z - proxy->a[2];
+    float lengthSq = abx * abx + aby * aby + abz * abz;
+    float t = lengthSq > 0.0f ? (apx * abx + apy * aby + apz * abz) / lengthSq : 0.0f;
+    t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+    float dx = apx - t * abx, dy = apy - t * aby, dz = apz - t * abz;
+    float distanceSq = dx * dx + dy * dy + dz * dz;
+    float radius = proxy->radius + CLOTH_THICKNESS;
+    if (!(distanceSq < radius * radius) || distanceSq == 0.0f) return;
+    float toSurface = radius / sqrtf(distanceSq);
+    *x = proxy->a[0] + t * abx + dx * toSurface;
+    *y = proxy->a[1] + t * aby + dy * toSurface;
+    *z = proxy->a[2] + t * abz + dz * toSurface;
+}
+
+/* Function to advance a cloth by deltaTime with XPBD. Each substep predicts the particles' positions, solves the
+   constraints one color at a time, pushes the particles out of the body proxies and derives velocities from the
+   corrected positions. With one iteration per
+   substep the Lagrange multiplier starts every solve at zero, so a constraint's update reduces to
+   dlambda = -C / (wa + wb + compliance / h^2) and no multiplier has to be stored.
+
+   All substeps run in one OpenMP parallel region. The constraints of a color are split between the threads,
+   and `omp for simd` vectorizes each thread's share, which is safe because no particle occurs twice within a
+   color. The implicit barrier at the end of every loop orders the colors. Built without OpenMP, the pragmas are
+   ignored and the same code runs on one thread.
+
+   Collision looks every particle's cell up in the proxy hash and tests only the proxies of its bucket, so its
+   cost grows linearly with the number of particles. Each particle is handled by one thread, again without
+   atomics. On the first substep of a frame the proxies have just moved, so the substep's start positions are
+   pushed out as well: cloth that a body part moved into is separated without gaining the velocity of the
+   separation. Later substeps start where the previous one pushed the particles out. */
+void clothStep(struct Cloth *cloth, const struct BodyPart *bodyPart, const struct ProxyHash *hash,
+               float deltaTime) {
+    float *x = cloth->x, *y = cloth->y, *z = cloth->z;
+    float *prevX = cloth->prevX, *prevY = cloth->prevY, *prevZ = cloth->prevZ;
+    float *vx = cloth->vx, *vy = cloth->vy, *vz = cloth->vz;
+    const float *invMass = cloth->invMass;
+    const int *first = cloth->first, *second = cloth->second;
+    const float *restLength = cloth->restLength, *compliance = cloth->compliance;
+    int numParticles = cloth->numParticles, columns = cloth->columns;
+
+    /* The pinned top row moves from where it is to the body part's new position in even steps */
+    for (int c = 0; c < columns; c++) {
+        cloth->pinnedFromX[c] = x[c];
+        cloth->pinnedFromY[c] = y[c];
+    }
+    float h = deltaTime / CLOTH_SUBSTEPS;
+    float alphaScale = 1.0f / (h * h);
+    float damping = 1.0f - CLOTH_DAMPING * h > 0.0f ? 1.0f - CLOTH_DAMPING * h : 0.0f;
+
+    #pragma omp parallel
+    for (int step = 0; step < CLOTH_SUBSTEPS; step++) {
+        float blend = (float)(step + 1) / CLOTH_SUBSTEPS;
+
+        #pragma omp for simd
+        for (int i = 0; i < numParticles; i++) {
+            prevX[i] = x[i];
+            prevY[i] = y[i];
+            prevZ[i] = z[i];
+            float moves = invMass[i] > 0.0f ? 1.0f : 0.0f;
+            vx[i] = vx[i] * damping * moves;
+            vy[i] = (vy[i] + GRAVITY * h) * damping * moves;
+            vz[i] = vz[i] * damping * moves;
+            x[i] += vx[i] * h;
+            y[i] += vy[i] * h;
+            z[i] += vz[i] * h;
+        }
+
+        #pragma omp for
+        for (int c = 0; c < columns; c++) {
+            float targetX = bodyPart->x + bodyPart->scale * c / (columns - 1);
+            float targetY = bodyPart->y + bodyPart->scale;
+            x[c] = cloth->pinnedFromX[c] + (targetX - cloth->pinnedFromX[c]) * blend;
+            y[c] = cloth->pinnedFromY[c] + (targetY - cloth->pinnedFromY[c]) * blend;
+        }
+
+        for (int color = 0; color < cloth->numColors; color++) {
+            #pragma omp for simd
+            for (int k = cloth->colorStart[color]; k < cloth->colorStart[color + 1]; k++) {
+                int a = first[k], b = second[k];
+                float wa = invMass[a], wb = invMass[b];
+                float dx = x[a] - x[b], dy = y[a] - y[b], dz = z[a] - z[b];
+                float length = sqrtf(dx * dx + dy * dy + dz * dz);
+                float w = (wa + wb) + compliance[k] * alphaScale;
+                float s = length > 0.0f && w > 0.0f ? (length - restLength[k]) / (w * length) : 0.0f;
+                x[a] -= wa * s * dx;
+                y[a] -= wa * s * dy;
+                z[a] -= wa * s * dz;
+                x[b] += wb * s * dx;
+                y[b] += wb * s * dy;
+                z[b] += wb * s * dz;
+            }
+        }
+
+        if (hash->numEntries > 0) {
+            #pragma omp for
+            for (int i = 0; i < numParticles; i++) {
+                if (invMass[i] == 0.0f) continue;
+                int bucket = collisionBucket(collisionCell(x[i]), collisionCell(y[i]), collisionCell(z[i]),
+                                             hash->numBuckets);
+                for (int e = hash->bucketStart[bucket]; e < hash->bucketStart[bucket + 1]; e++) {
+                    pushOutOfProxy(&hash->proxies[hash->entries[e]], &x[i], &y[i], &z[i]);
+                    if (step == 0) pushOutOfProxy(&hash->proxies[hash->entries[e]], &prevX[i], &prevY[i], &prevZ[i]);
+                }
+            }
+        }
+
+        #pragma omp for simd
+        for (int i = 0; i < numParticles; i++) {
+            vx[i] = (x[i] - prevX[i]) / h;
+            vy[i] = (y[i] - prevY[i]) / h;
+            vz[i] = (z[i] - prevZ[i]) / h;
+        }
+    }
+}
+
 void updateClothing(struct Clothing *cloth, float deltaTime) {
     for (int i = 0; i < cloth->numBodyParts; i++) {
         struct BodyPart *bodyPart = &cloth->bodyParts[i];
@@ -48,8 +500,20 @@ void updateClothing(struct Clothing *cloth, float deltaTime) {
         bodyPart->x += bodyPart->scale * bodyPart->rotationX * deltaTime;
         bodyPart->y += bodyPart->scale * bodyPart->rotationY * deltaTime;
 
-        // Apply gravity to the body part
-        bodyPart->y += 9.8f * deltaTime;
+        // Place the body under the body part: a capsule behind the garment's middle that bulges through it, so
+        // the garment drapes over it. Every garment collides with every body part's proxy.
+        float s = bodyPart->scale;
+        struct BodyProxy proxy = {{bodyPart->x + 0.5f * s, bodyPart->y + 0.7f * s, 0.85f},
+                                  {bodyPart->x + 0.5f * s, bodyPart->y + 0.2f * s, 0.85f}, 0.2f * s};
+        cloth->proxies[i] = proxy;
+    }
+    if (proxyHashBuild(&cloth->proxyHash, cloth->proxies, cloth->numBodyParts) != 0) {
+        fprintf(stderr, "Out of memory building the collision hash; cloth does not collide this frame\n");
+    }
+
+    // Let each garment follow its body part, fall under gravity and drape over the body
+    for (int i = 0; i < cloth->numBodyParts; i++) {
+        clothStep(&cloth->garments[i], &cloth->bodyParts[i], &cloth->proxyHash, deltaTime);
     }
 }
 
@@ -61,15 +525,17 @@ void renderClothing(struct Clothing *cloth) {
 
     for (int i = 0; i < cloth->numBodyParts; i++) {
         struct BodyPart *bodyPart = &cloth->bodyParts[i];
+        struct Cloth *garment = &cloth->garments[i];
 
-        // Draw the body part with its texture
+        // Draw the garment's triangles with its texture stretched over the grid
         glBindTexture(GL_TEXTURE_2D, atoi(bodyPart->textureName)); // Replace with a texture ID
-        glBegin(GL_QUADS);
-        glTexCoord2f(0.0f, 0.0f); glVertex3f(bodyPart->x, bodyPart->y, 1.0f);
-        glTexCoord2f(1.0f, 0.0f); glVertex3f(bodyPart->x + bodyPart->scale, bodyPart->y, 1.0f);
-        glTexCoord2f(1.0f, 1.0f); glVertex3f(bodyPart->x + bodyPart->scale, bodyPart->y + bodyPart->scale,
-1.0f);
-        glTexCoord2f(0.0f, 1.0f); glVertex3f(bodyPart->x, bodyPart->y + bodyPart->scale, 1.0f);
+        glBegin(GL_TRIANGLES);
+        for (int k = 0; k < 3 * garment->numTriangles; k++) {
+            int p = garment->triangles[k];
+            glTexCoord2f((float)(p % garment->columns) / (garment->columns - 1),
+                         1.0f - (float)(p / garment->columns) / (garment->rows - 1));
+            glVertex3f(garment->x[p], garment->y[p], garment->z[p]);
+        }
         glEnd();
     }
 }
@@ -82,18 +548,22 @@ int main() {
     glewInit();
 
     // Create some example clothes
-    struct Clothing cloth;
-    cloth.numBodyParts = 3;
-
-    struct BodyPart bodyParts[] = {
-        {"shirt.png", 0.5f, 0.0f, 1.0f}, // Shirt
-        {"pants.png", 0.5f, -1.0f, 1.0f}, // Pants
-        {"jacket.png", 0.5f, -2.0f, 1.0f} // Jacket
+    static const struct BodyPart bodyParts[] = {
+        {.x = 0.5f, .y = 0.0f, .z = 1.0f, .textureName = "shirt.png", .scale = 1.0f},  // Shirt
+        {.x = 0.5f, .y = -1.0f, .z = 1.0f, .textureName = "pants.png", .scale = 1.0f}, // Pants
+        {.x = 0.5f, .y = -2.0f, .z = 1.0f, .textureName = "jacket.png", .scale = 1.0f} // Jacket
     };
+    struct Clothing cloth;
+    memset(&cloth, 0, sizeof(cloth));
+    cloth.numBodyParts = sizeof(bodyParts) / sizeof(bodyParts[0]);
+    memcpy(cloth.bodyParts, bodyParts, sizeof(bodyParts));
 
     for (int i = 0; i < cloth.numBodyParts; i++) {
         struct BodyPart *bodyPart = &cloth.bodyParts[i];
-        bodyPart->textureName[256] = '0' + atoi(bodyPart->textureName);
+        if (clothInitGrid(&cloth.garments[i], bodyPart, 32, 32) != 0) {
+            fprintf(stderr, "Out of memory creating the cloth of %s\n", bodyPart->textureName);
+            return 1;
+        }
     }
 
     // Main loop
@@ -116,4 +586,13 @@ handling) to create a fully functional simulation.
 
 Remember to replace the texture names with actual file paths or IDs, and adjust the scale and rotation values
 according to your specific use case.
+
+Each body part now carries a cloth: a grid of particles hanging from the body part, simulated with XPBD. Positions,
+velocities and constraints are stored as separate arrays, and the constraints are grouped into colors that share
+no particle, so clothStep can solve a whole color with `#pragma omp for simd` and no atomics. Build with -fopenmp
+to spread it over all cores; without it the same code runs on one thread.
+
+Every body part also places a capsule, the body under its garment, in a spatial hash once per frame. Each
+substep looks every particle's cell up in the hash and pushes it out of the few capsules in its bucket, so
+garments drape over the body and collision cost grows only linearly with cloth resolution.
 */
\ No newline at end of file
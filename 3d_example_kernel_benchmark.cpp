@@ -0,0 +1,476 @@
+/* Here's a micro-benchmark suite for the vector and transform kernels of the linear algebra and polygon examples.
+It needs no benchmark library: a small harness times each kernel and writes the results as JSON.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "simd_dispatch.h"
+#include "worker_pool.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// The kernels are timed where they are defined: each example is compiled into its own namespace, without its
+// main() and its window code. Every header the examples use is included above, so none is pulled into a namespace.
+#define KERNEL_BENCHMARK 1
+namespace linalg {
+#include "3d_example_adv_linear_alg.cpp"
+}
+namespace polygon {
+#include "3d_example_5.cpp"
+}
+
+// Function to keep the compiler from optimizing away work whose results the benchmark never reads
+inline void clobberMemory(const void* p) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(p) : "memory");
+#else
+    static volatile const void* sink;
+    sink = p;
+#endif
+}
+
+// Working-set sizes the benchmarks are run at: each benchmark sizes its arrays so that inputs plus outputs take
+// about this many bytes
+struct Residency {
+    const char* name;
+    size_t bytes;
+};
+
+// Define the result of one benchmark. The JSON fields follow Google Benchmark's output, so its compare.py can
+// diff two runs.
+struct BenchmarkResult {
+    std::string name;
+    std::string operation, layout, variant, residency;
+    size_t elements;
+    size_t bytesPerElement;
+    size_t iterations;
+    double realNs; // per iteration, fastest repetition
+    double cpuNs;
+};
+
+class BenchmarkSuite {
+public:
+    BenchmarkSuite(double minSeconds, int repetitions, std::string filter, FILE* log)
+        : minSeconds(minSeconds), repetitions(repetitions), filter(std::move(filter)), log(log) {}
+
+    bool wants(const std::string& name) const { return filter.empty() || name.find(filter) != std::string::npos; }
+
+    // Function to time `body`, which processes `elements` items per call. The iteration count is calibrated so
+    // that one repetition lasts at least minSeconds, and the fastest repetition is kept.
+    void run(const std::string& operation, const std::string& layout, const std::string& variant,
+             const Residency& residency, size_t elements, size_t bytesPerElement,
+             const std::function<void()>& body) {
+        BenchmarkResult result;
+        result.operation = operation;
+        result.layout = layout;
+        result.variant = variant;
+        result.residency = residency.name;
+        result.name = operation + "/" + layout + "/" + variant + "/" + residency.name;
+        result.elements = elements;
+        result.bytesPerElement = bytesPerElement;
+
+        body(); // warm up caches and the lazily dispatched kernels
+        size_t iterations = 1;
+        for (;;) {
+            double seconds = timeIterations(body, iterations).first;
+            if (seconds >= minSeconds || iterations >= (size_t(1) << 30)) break;
+            double scale = seconds > 0.0 ? 1.4 * minSeconds / seconds : 10.0;
+            iterations = std::max(iterations + 1, size_t(double(iterations) * std::min(scale, 10.0)));
+        }
+
+        result.iterations = iterations;
+        result.realNs = result.cpuNs = 1e300;
+        for (int r = 0; r < repetitions; ++r) {
+            std::pair<double, double> seconds = timeIterations(body, iterations);
+            result.realNs = std::min(result.realNs, seconds.first * 1e9 / double(iterations));
+            result.cpuNs = std::min(result.cpuNs, seconds.second * 1e9 / double(iterations));
+        }
+
+        std::fprintf(log, "%-40s %10zu elements %9.3f ns/element %8.2f GB/s\n", result.name.c_str(), elements,
+                     result.realNs / double(elements), bytesPerSecond(result) * 1e-9);
+        std::fflush(log);
+        results.push_back(result);
+    }
+
+    // Function to write every result as a Google Benchmark style JSON document
+    void writeJson(FILE* out, const char* executable, const std::string& vectorPath,
+                   const std::string& transformPath) const {
+        char date[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+        std::fprintf(out, "{\n  \"context\": {\n");
+        std::fprintf(out, "    \"date\": \"%s\",\n", date);
+        std::fprintf(out, "    \"executable\": \"%s\",\n", escaped(executable).c_str());
+        std::fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+        std::fprintf(out, "    \"vector3_simd\": \"%s\",\n", vectorPath.c_str());
+        std::fprintf(out, "    \"transform_simd\": \"%s\",\n", transformPath.c_str());
+#ifdef NDEBUG
+        std::fprintf(out, "    \"library_build_type\": \"release\"\n");
+#else
+        std::fprintf(out, "    \"library_build_type\": \"debug\"\n");
+#endif
+        std::fprintf(out, "  },\n  \"benchmarks\": [");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchmarkResult& r = results[i];
+            std::fprintf(out, "%s\n    {\n", i == 0 ? "" : ",");
+            std::fprintf(out, "      \"name\": \"%s\",\n", r.name.c_str());
+            std::fprintf(out, "      \"run_name\": \"%s\",\n", r.name.c_str());
+            std::fprintf(out, "      \"run_type\": \"iteration\",\n");
+            std::fprintf(out, "      \"repetitions\": %d,\n", repetitions);
+            std::fprintf(out, "      \"iterations\": %zu,\n", r.iterations);
+            std::fprintf(out, "      \"real_time\": %.6f,\n", r.realNs);
+            std::fprintf(out, "      \"cpu_time\": %.6f,\n", r.cpuNs);
+            std::fprintf(out, "      \"time_unit\": \"ns\",\n");
+            std::fprintf(out, "      \"bytes_per_second\": %.6e,\n", bytesPerSecond(r));
+            std::fprintf(out, "      \"items_per_second\": %.6e,\n", double(r.elements) * 1e9 / r.realNs);
+            std::fprintf(out, "      \"operation\": \"%s\",\n", r.operation.c_str());
+            std::fprintf(out, "      \"layout\": \"%s\",\n", r.layout.c_str());
+            std::fprintf(out, "      \"variant\": \"%s\",\n", r.variant.c_str());
+            std::fprintf(out, "      \"residency\": \"%s\",\n", r.residency.c_str());
+            std::fprintf(out, "      \"elements\": %zu\n", r.elements);
+            std::fprintf(out, "    }");
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
+
+private:
+    // Returns wall-clock and process CPU seconds for `iterations` calls
+    static std::pair<double, double> timeIterations(const std::function<void()>& body, size_t iterations) {
+        std::clock_t cpuStart = std::clock();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) body();
+        auto end = std::chrono::steady_clock::now();
+        std::clock_t cpuEnd = std::clock();
+        return {std::chrono::duration<double>(end - start).count(), double(cpuEnd - cpuStart) / CLOCKS_PER_SEC};
+    }
+
+    static double bytesPerSecond(const BenchmarkResult& r) {
+        return double(r.elements * r.bytesPerElement) * 1e9 / r.realNs;
+    }
+
+    static std::string escaped(const char* text) {
+        std::string out;
+        for (; *text; ++text) {
+            if (*text == '"' || *text == '\\') out += '\\';
+            out += *text;
+        }
+        return out;
+    }
+
+    double minSeconds;
+    int repetitions;
+    std::string filter;
+    FILE* log; // where the table is printed while the benchmarks run
+    std::vector<BenchmarkResult> results;
+};
+
+// Define SoA input and output arrays for the vector benchmarks, filled with values in [-1, 1]
+struct SoABuffers {
+    polygon::AlignedFloats a[3], b[3], out[3], scalars;
+
+    explicit SoABuffers(size_t n) {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        for (int c = 0; c < 3; ++c) {
+            a[c].resize(n);
+            b[c].resize(n);
+            out[c].resize(n);
+            for (size_t i = 0; i < n; ++i) {
+                a[c][i] = dist(rng);
+                b[c][i] = dist(rng);
+            }
+        }
+        scalars.resize(n);
+    }
+
+    linalg::Vector3Span spanA() const { return {a[0].data(), a[1].data(), a[2].data(), a[0].size()}; }
+    linalg::Vector3Span spanB() const { return {b[0].data(), b[1].data(), b[2].data(), b[0].size()}; }
+    linalg::MutableVector3Span spanOut() { return {out[0].data(), out[1].data(), out[2].data(), out[0].size()}; }
+};
+
+// The same vectors as an array of padded Vector3f structures
+struct AoSBuffers {
+    std::vector<linalg::Vector3f> a, b, out;
+    std::vector<float> scalars;
+
+    explicit AoSBuffers(const SoABuffers& soa) {
+        size_t n = soa.a[0].size();
+        for (size_t i = 0; i < n; ++i) {
+            a.emplace_back(soa.a[0][i], soa.a[1][i], soa.a[2][i]);
+            b.emplace_back(soa.b[0][i], soa.b[1][i], soa.b[2][i]);
+        }
+        out.resize(n);
+        scalars.resize(n);
+    }
+};
+
+// Function to list the SIMD paths of a kernel family that the running CPU supports, scalar first
+template <typename Path, typename Supported>
+std::vector<Path> supportedPaths(std::initializer_list<Path> candidates, Supported isSupported) {
+    std::vector<Path> paths;
+    for (Path path : candidates) {
+        if (isSupported(path)) paths.push_back(path);
+    }
+    return paths;
+}
+
+void benchmarkVectorOps(BenchmarkSuite& suite, const Residency& residency) {
+    std::vector<SimdPath> paths = supportedPaths({SimdPath::Scalar, SimdPath::AVX2, SimdPath::AVX512},
+                                                 isSimdPathSupported);
+
+    // Bytes per element read and written: AoS moves the padding lane too
+    struct Operation {
+        const char* name;
+        size_t aosBytes, soaBytes;
+    };
+    const Operation operations[] = {{"dot", 36, 28},       {"cross", 48, 36},   {"normalize", 32, 24},
+                                    {"normalize_fast", 32, 24}, {"reflect", 48, 36}, {"project", 48, 36}};
+
+    // Size the shared buffers for the heaviest operation so every operation stays within the residency
+    size_t n = std::max<size_t>(16, residency.bytes / 48);
+    SoABuffers soa(n);
+    AoSBuffers aos(soa);
+
+    for (const Operation& op : operations) {
+        std::string name = op.name;
+        size_t elements = std::max<size_t>(16, std::min(n, residency.bytes / op.soaBytes));
+        size_t aosElements = std::max<size_t>(16, std::min(n, residency.bytes / op.aosBytes));
+
+        // AoS: the Vector3f member functions applied one vector at a time
+        if (suite.wants(name + "/aos/Vector3f/" + residency.name)) {
+            const linalg::Vector3f* a = aos.a.data();
+            const linalg::Vector3f* b = aos.b.data();
+            linalg::Vector3f* out = aos.out.data();
+            float* scalars = aos.scalars.data();
+            std::function<void()> body;
+            if (name == "dot") {
+                body = [=] {
+                    for (size_t i = 0; i < aosElements; ++i) scalars[i] = a[i].dotProduct(b[i]);
+                    clobberMemory(scalars);
+                };
+            } else if (name == "cross") {
+                body = [=] {
+                    for (size_t i = 0; i < aosElements; ++i) out[i] = a[i].crossProduct(b[i]);
+                    clobberMemory(out);
+                };
+            } else if (name == "reflect") {
+                body = [=] {
+                    for (size_t i = 0; i < aosElements; ++i) out[i] = a[i].reflect(b[i]);
+                    clobberMemory(out);
+                };
+            } else if (name == "project") {
+                body = [=] {
+                    for (size_t i = 0; i < aosElements; ++i) out[i] = a[i].project(b[i]);
+                    clobberMemory(out);
+                };
+            } else {
+                // Vector3f has a single normalize(); both normalize benchmarks time it
+                body = [=] {
+                    for (size_t i = 0; i < aosElements; ++i) out[i] = a[i].normalize();
+                    clobberMemory(out);
+                };
+            }
+            suite.run(name, "aos", "Vector3f", residency, aosElements, op.aosBytes, body);
+        }
+
+        // SoA: the batch kernels on every supported path
+        for (SimdPath path : paths) {
+            std::string variant = simdPathName(path);
+            if (!suite.wants(name + "/soa/" + variant + "/" + residency.name)) continue;
+
+            const linalg::Vector3Kernels kernels = linalg::vector3KernelsFor(path);
+            const float *ax = soa.a[0].data(), *ay = soa.a[1].data(), *az = soa.a[2].data();
+            const float *bx = soa.b[0].data(), *by = soa.b[1].data(), *bz = soa.b[2].data();
+            float *ox = soa.out[0].data(), *oy = soa.out[1].data(), *oz = soa.out[2].data();
+            float* scalars = soa.scalars.data();
+            size_t count = elements;
+            std::function<void()> body;
+            if (name == "dot") {
+                body = [=] { kernels.dot(ax, ay, az, bx, by, bz, scalars, count); };
+            } else if (name == "normalize" || name == "normalize_fast") {
+                linalg::NormalizeKernel kernel = name == "normalize" ? kernels.normalize : kernels.normalizeFast;
+                body = [=] { kernel(ax, ay, az, ox, oy, oz, count); };
+            } else {
+                linalg::PairKernel kernel = name == "cross" ? kernels.cross
+                                            : name == "reflect" ? kernels.reflect
+                                                                : kernels.project;
+                body = [=] { kernel(ax, ay, az, bx, by, bz, ox, oy, oz, count); };
+            }
+            suite.run(name, "soa", variant, residency, elements, op.soaBytes, body);
+        }
+    }
+}
+
+void benchmarkTransforms(BenchmarkSuite& suite, const Residency& residency) {
+    std::vector<SimdPath> paths = supportedPaths(
+        {SimdPath::Scalar, SimdPath::SSE2, SimdPath::AVX2, SimdPath::AVX512}, isSimdPathSupported);
+
+    const size_t bytesPerPoint = 2 * 3 * sizeof(float); // read and write x, y, z
+    size_t n = std::max<size_t>(16, residency.bytes / bytesPerPoint);
+    const polygon::Affine3x4 m = polygon::Affine3x4::rotationX(30.0f);
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<polygon::Point> points(n);
+    for (polygon::Point& p : points) p = polygon::Point(dist(rng), dist(rng), dist(rng));
+
+    // AoS: the interleaved {x, y, z} loop the polygon used before its vertices moved to SoA
+    if (suite.wants(std::string("transform/aos/Scalar/") + residency.name)) {
+        std::vector<polygon::Point> out(n);
+        const polygon::Point* in = points.data();
+        polygon::Point* result = out.data();
+        suite.run("transform", "aos", "Scalar", residency, n, bytesPerPoint, [=, &m] {
+            for (size_t i = 0; i < n; ++i) {
+                const polygon::Point& p = in[i];
+                result[i].x = m.m[0][0] * p.x + m.m[0][1] * p.y + m.m[0][2] * p.z + m.m[0][3];
+                result[i].y = m.m[1][0] * p.x + m.m[1][1] * p.y + m.m[1][2] * p.z + m.m[1][3];
+                result[i].z = m.m[2][0] * p.x + m.m[2][1] * p.y + m.m[2][2] * p.z + m.m[2][3];
+            }
+            clobberMemory(result);
+        });
+    }
+
+    // SoA: the transform kernels on every supported path
+    polygon::PointsSoA in(points), out;
+    out.resize(n);
+    for (SimdPath path : paths) {
+        std::string variant = simdPathName(path);
+        if (!suite.wants("transform/soa/" + variant + "/" + residency.name)) continue;
+        polygon::TransformKernel kernel = polygon::transformKernelFor(path);
+        const float *x = in.x.data(), *y = in.y.data(), *z = in.z.data();
+        float *ox = out.x.data(), *oy = out.y.data(), *oz = out.z.data();
+        suite.run("transform", "soa", variant, residency, n, bytesPerPoint,
+                  [=, &m] { kernel(m, x, y, z, ox, oy, oz, n); });
+    }
+
+    // Polygons: rotating and scaling many small polygons in place through the Polygon member functions, as the
+    // scene loop does
+    struct PolygonOperation {
+        const char* name;
+        void (*apply)(polygon::Polygon&);
+    };
+    const PolygonOperation polygonOperations[] = {
+        {"polygon_rotate_x", [](polygon::Polygon& p) { p.rotateX(1.0f); }},
+        {"polygon_rotate_y", [](polygon::Polygon& p) { p.rotateY(1.0f); }},
+        {"polygon_scale", [](polygon::Polygon& p) { p.scale(1.0f); }}};
+    const size_t verticesPerPolygon = 4;
+    std::vector<polygon::Polygon> polygons;
+    std::string variant = simdPathName(detectSimdPath());
+    for (const PolygonOperation& op : polygonOperations) {
+        if (!suite.wants(std::string(op.name) + "/polygons/" + variant + "/" + residency.name)) continue;
+        if (polygons.empty()) {
+            polygons.reserve(n / verticesPerPolygon);
+            for (size_t i = 0; i + verticesPerPolygon <= n; i += verticesPerPolygon) {
+                polygons.emplace_back(std::vector<polygon::Point>(points.begin() + i,
+                                                                  points.begin() + i + verticesPerPolygon));
+            }
+        }
+        size_t vertexCount = polygons.size() * verticesPerPolygon;
+        void (*apply)(polygon::Polygon&) = op.apply;
+        suite.run(op.name, "polygons", variant, residency, vertexCount, bytesPerPoint, [&polygons, apply] {
+            for (polygon::Polygon& p : polygons) apply(p);
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* jsonPath = nullptr;
+    std::string filter;
+    double minSeconds = 0.1;
+    int repetitions = 5;
+    size_t dramMegabytes = 256;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--json=") == 0) {
+            jsonPath = argv[i] + 7;
+        } else if (arg.compare(0, 9, "--filter=") == 0) {
+            filter = arg.substr(9);
+        } else if (arg.compare(0, 11, "--min-time=") == 0) {
+            minSeconds = std::atof(arg.c_str() + 11);
+        } else if (arg.compare(0, 14, "--repetitions=") == 0) {
+            repetitions = std::max(1, std::atoi(arg.c_str() + 14));
+        } else if (arg.compare(0, 10, "--dram-mb=") == 0) {
+            dramMegabytes = std::max(1, std::atoi(arg.c_str() + 10));
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--json=FILE|-] [--filter=SUBSTRING] [--min-time=SECONDS] "
+                         "[--repetitions=N] [--dram-mb=N]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    // Benchmarks are only meaningful if the kernels being timed are correct
+    if (!linalg::verifyVector3Kernels() || !polygon::verifyTransformKernels()) {
+        std::fprintf(stderr, "kernel self-check failed\n");
+        return 1;
+    }
+
+    // 16 KB fits every L1 data cache, 256 KB fits L2 but not L1, and the DRAM size should exceed the last-level
+    // cache
+    const Residency residencies[] = {
+        {"L1", size_t(16) << 10}, {"L2", size_t(256) << 10}, {"DRAM", dramMegabytes << 20}};
+
+    // With --json=- the JSON document goes to stdout, so the table goes to stderr
+    bool jsonToStdout = jsonPath && std::strcmp(jsonPath, "-") == 0;
+    BenchmarkSuite suite(minSeconds, repetitions, filter, jsonToStdout ? stderr : stdout);
+    for (const Residency& residency : residencies) {
+        benchmarkVectorOps(suite, residency);
+        benchmarkTransforms(suite, residency);
+    }
+
+    if (jsonPath) {
+        FILE* out = jsonToStdout ? stdout : std::fopen(jsonPath, "w");
+        if (!out) {
+            std::perror(jsonPath);
+            return 1;
+        }
+        suite.writeJson(out, argv[0], simdPathName(detectSimdPath(SimdPath::AVX2)),
+                        simdPathName(detectSimdPath()));
+        if (out != stdout) std::fclose(out);
+    }
+    return 0;
+}
+/*
+This program measures the kernels of `3d_example_adv_linear_alg.cpp` and `3d_example_5.cpp` by including both
+files with `KERNEL_BENCHMARK` defined, which leaves out their `main()` functions and window code. Each example
+goes into its own namespace, so the names both of them define do not clash, and the benchmarks time exactly the
+code the examples run. Both examples take `SimdPath` and its CPU checks from simd_dispatch.h, which is included
+once at global scope, like every other header.
+
+Every vector operation (dot, cross, normalize, fast normalize, reflect and project) and the affine transform are
+timed at three working-set sizes: 16 KB (L1-resident), 256 KB (L2-resident) and 256 MB (DRAM-resident, adjustable
+with `--dram-mb`). Each one runs over an array of `Vector3f`/`Point` structures (AoS) and over separate x, y and z
+arrays (SoA) with every SIMD path the CPU supports. `polygon_rotate_x`, `polygon_rotate_y` and `polygon_scale`
+time `Polygon::rotateX()`, `rotateY()` and `scale()` over many four-vertex polygons, where the per-call overhead
+dominates. `Polygon` has no Z rotation, so there is none to time.
+
+The harness calibrates the iteration count until one repetition lasts `--min-time` seconds and keeps the fastest
+of `--repetitions` runs. A table is printed as the benchmarks run; `--json=FILE` also writes the results in the
+format of Google Benchmark, so two runs (for example of two releases) can be compared with its
+`tools/compare.py benchmarks old.json new.json`. Run a release build pinned to one core, for example
+`g++ -std=c++17 -O2 3d_example_kernel_benchmark.cpp && taskset -c 2 ./a.out --json=kernels.json`.
+*/
\ No newline at end of file
@@ -16,6 +16,8 @@ Here's an example of how you could implement these techniques in C++:
 */
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <cstdlib>
+#include "frame_allocator.h"
 
 // Define some constants for the skybox texture
 const int SKYBOX_SIZE = 256;
@@ -26,8 +28,8 @@ class Scene {
 public:
     // Function to render the background using a skybox
     void renderSkybox() {
-        // Load the skybox texture
-        unsigned char* skyboxTexture = new unsigned char[SKYBOX_SIZE * SKYBOX_SIZE * 3];
+        // Load the skybox texture into frame scratch memory; glTexImage2D copies it, so it is not needed afterwards
+        unsigned char* skyboxTexture = frameAllocator.allocateArray<unsigned char>(SKYBOX_SIZE * SKYBOX_SIZE * 3);
         for (int i = 0; i < SKYBOX_SIZE; ++i) {
             for (int j = 0; j < SKYBOX_SIZE; ++j) {
                 // Generate a random color for each pixel
@@ -63,9 +65,6 @@ skyboxTexture);
             glVertex3fv(&quadVertices[i]);
         }
         glEnd();
-
-        // Clean up
-        delete[] skyboxTexture;
     }
 
     // Function to render the scene using OpenGL
@@ -74,8 +73,9 @@ skyboxTexture);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Set up the lighting
+        static const float lightPosition[] = {0.0f, 1.0f, 2.0f, 0.0f};
         glEnable(GL_LIGHTING);
-        glLightfv(GL_LIGHT0, GL_POSITION, new float[] {0.0f, 1.0f, 2.0f});
+        glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
 
         // Render the skybox
         renderSkybox();
@@ -94,6 +94,13 @@ skyboxTexture);
         }
         glEnd();
     }
+
+    // Function to call once the frame is presented; recycles the scratch memory of two frames ago
+    void endFrame() { frameAllocator.endFrame(); }
+
+private:
+    // Scratch memory for per-frame temporary buffers, sized for the skybox texture plus headroom
+    FrameAllocator frameAllocator{SKYBOX_SIZE * SKYBOX_SIZE * 3 + 64 * 1024};
 };
 
 // Create a Scene object and render it using OpenGL
@@ -103,6 +110,7 @@ int main() {
     while (!glfwWindowShouldClose()) {
         // Render the scene
         scene.renderScene();
+        scene.endFrame();
 
         // Poll events
         glfwPollEvents();
@@ -113,4 +121,8 @@ int main() {
 /*
 This code creates a basic 3D scene with a skybox and foreground objects. The skybox is rendered using a quad,
 and the lighting is set up to create a sense of depth and distance.
+
+The skybox texture is generated every frame, so its pixel buffer comes from a `FrameAllocator` rather than
+`new[]`/`delete[]`: the allocator bumps a pointer through a preallocated buffer and is rewound at the end of the
+frame, which keeps the render loop free of heap allocations.
 */
\ No newline at end of file
@@ -2,106 +2,302 @@
 count of a 3D model based on distance from the camera.
 */
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
 #include <vector>
+#include "mesh_simplifier.h"
 
-// Define a 3D point structure
-struct Point {
-    float x, y, z;
+// One entry of a LOD chain: the simplified mesh and a world-space upper bound on how far its surface deviates
+// from the full-detail mesh
+struct LodLevel {
+    TriangleMesh mesh;
+    float geometricError;
+};
 
-    // Constructor to initialize point with coordinates
-    Point(float x = 0.0f, float y = 0.0f, float z = 0.0f) : x(x), y(y), z(z) {}
+// Function to build a LOD chain from a full-detail mesh. Level 0 is the input itself; each ratio (for example
+// 0.5 for half the triangles) adds a coarser level. A single simplification pass produces every level, and a
+// level is dropped if the simplifier cannot get any further below the previous one.
+std::vector<LodLevel> buildLodChain(const TriangleMesh& mesh, std::vector<float> ratios) {
+    std::vector<LodLevel> chain;
+    chain.push_back({mesh, 0.0f});
 
-    // Function to draw the point as a sphere in SFML window
-    void draw(sf::RenderWindow& window) {
-        sf::SphereShape sphere(2);
-        sphere.setPosition(x, y, z);
-        window.draw(sphere);
+    std::sort(ratios.begin(), ratios.end(), std::greater<float>());
+    MeshSimplifier simplifier(mesh);
+    for (float ratio : ratios) {
+        if (ratio >= 1.0f) continue;
+        size_t target = std::max<size_t>(1, size_t(ratio * mesh.triangleCount()));
+        simplifier.simplifyTo(target);
+        if (simplifier.triangleCount() >= chain.back().mesh.triangleCount()) break;
+        chain.push_back({simplifier.extract(), simplifier.error()});
     }
+    return chain;
+}
+
+// Define a bounding sphere structure
+struct BoundingSphere {
+    Point center;
+    float radius;
 };
 
 // Define a Polygon class for modeling and transformations
 class Polygon {
 private:
-    std::vector<Point> vertices;
+    std::vector<LodLevel> lods; // lods[0] is full detail, each following level is coarser
+    size_t currentLod = 0;
+    BoundingSphere bounds;
 
-public:
-    // Constructor to initialize polygon with vertices
-    Polygon(const std::vector<Point>& vertices) : vertices(vertices) {}
-
-    // Function to calculate distance from camera
-    float getDistanceFromCamera() const {
-        return sqrt((vertices[0].x - 0.0f) * (vertices[0].x - 0.0f) +
-                   (vertices[0].y - 0.0f) * (vertices[0].y - 0.0f) +
-                   (vertices[0].z - 0.0f) * (vertices[0].z - 0.0f));
-    }
-
-    // Function to reduce polygon count based on distance from camera
-    void reducePolygonCount(float maxDistance) {
-        for (Point& v : vertices) {
-            if (v.x != 0.0f && v.y != 0.0f && v.z != 0.0f) {
-                float distance = getDistanceFromCamera();
-                if (distance > maxDistance) {
-                    // Create a new vertex with reduced coordinates
-                    Point newV(v.x / 2.0f, v.y / 2.0f, v.z / 2.0f);
-                    vertices.push_back(newV);
-                    // Remove the original vertex from the polygon
-                    vertices.erase(std::remove(vertices.begin(), vertices.end(), v),
-                                    vertices.end());
-                }
-            }
+    // Function to fit a sphere around the full-detail mesh (centre of the bounding box, farthest vertex)
+    void updateBounds() {
+        const std::vector<Point>& points = lods[0].mesh.positions;
+        if (points.empty()) {
+            bounds = {Point(), 0.0f};
+            return;
+        }
+        Point lo = points[0], hi = points[0];
+        for (const Point& p : points) {
+            lo = Point(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+            hi = Point(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+        }
+        Point center((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f);
+        float radiusSquared = 0.0f;
+        for (const Point& p : points) {
+            float dx = p.x - center.x, dy = p.y - center.y, dz = p.z - center.z;
+            radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
         }
+        bounds = {center, std::sqrt(radiusSquared)};
     }
 
+public:
+    // Constructor to initialize polygon with its full-detail mesh
+    Polygon(const TriangleMesh& mesh) : lods{{mesh, 0.0f}} { updateBounds(); }
+
+    // Sphere enclosing every level of the polygon
+    const BoundingSphere& boundingSphere() const { return bounds; }
+
+    // Function to precompute coarser versions of the mesh at the given triangle ratios
+    void generateLods(const std::vector<float>& ratios) {
+        lods = buildLodChain(lods[0].mesh, ratios);
+        currentLod = 0;
+    }
+
+    size_t lodCount() const { return lods.size(); }
+    const LodLevel& lod(size_t level) const { return lods[level]; }
+    const std::vector<LodLevel>& lodChain() const { return lods; }
+
+    // Function to choose which level of detail is drawn
+    void setLod(size_t level) { currentLod = std::min(level, lods.size() - 1); }
+
     // Function to draw the polygon in SFML window
     void draw(sf::RenderWindow& window) {
-        sf::Vertex line[] = {{vertices[0].x, vertices[0].y, vertices[0].z}, {vertices.back().x,
-vertices.back().y, vertices.back().z}};
-        window.draw(line, 2, sf::Lines);
+        const TriangleMesh& mesh = lods[currentLod].mesh;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const Point& a = mesh.positions[mesh.indices[i + k]];
+                const Point& b = mesh.positions[mesh.indices[i + (k + 1) % 3]];
+                sf::Vertex line[] = {{a.x, a.y, a.z}, {b.x, b.y, b.z}};
+                window.draw(line, 2, sf::Lines);
+            }
+        }
     }
 
-    // Function to rotate the polygon around X-axis
+    // Function to rotate the polygon around X-axis. Rotations are rigid, so every level keeps its error.
     void rotateX(float angle) {
-        for (Point& v : vertices) {
-            v.z = std::sin(angle / 57.2957795131f) * v.x - std::cos(angle / 57.2957795131f) * v.y;
-            v.y = std::cos(angle / 57.2957795131f) * v.x + std::sin(angle / 57.2957795131f) * v.z;
+        float s = std::sin(angle / 57.2957795131f);
+        float c = std::cos(angle / 57.2957795131f);
+        for (LodLevel& level : lods) {
+            for (Point& v : level.mesh.positions) v = Point(v.x, c * v.y - s * v.z, s * v.y + c * v.z);
         }
+        updateBounds();
     }
 
     // Function to rotate the polygon around Y-axis
     void rotateY(float angle) {
-        for (Point& v : vertices) {
-            float newX = v.y * std::cos(angle / 57.2957795131f) - v.z * std::sin(angle / 57.2957795131f);
-            float newY = v.x * std::sin(angle / 57.2957795131f) + v.z * std::cos(angle / 57.2957795131f);
-            v.y = newX;
-            v.x = newY;
-
-            // Update z coordinate for rotation
-            Point tempPoint(v.x, v.y, v.z);
-            v.x = newX;
-            v.y = newY;
+        float s = std::sin(angle / 57.2957795131f);
+        float c = std::cos(angle / 57.2957795131f);
+        for (LodLevel& level : lods) {
+            for (Point& v : level.mesh.positions) v = Point(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
         }
+        updateBounds();
     }
 
     // Function to scale the polygon by factor
     void scale(float factor) {
-        for (Point& v : vertices) {
-            v.x *= factor;
-            v.y *= factor;
-            v.z *= factor;
+        for (LodLevel& level : lods) {
+            for (Point& v : level.mesh.positions) {
+                v.x *= factor;
+                v.y *= factor;
+                v.z *= factor;
+            }
+        }
+        for (LodLevel& level : lods) level.geometricError *= std::fabs(factor);
+        updateBounds();
+    }
+
+    // Function to move the polygon by an offset
+    void translate(float dx, float dy, float dz) {
+        for (LodLevel& level : lods) {
+            for (Point& v : level.mesh.positions) {
+                v.x += dx;
+                v.y += dy;
+                v.z += dz;
+            }
         }
+        bounds.center = Point(bounds.center.x + dx, bounds.center.y + dy, bounds.center.z + dz);
     }
 };
 
+// Define a simple perspective camera
+struct Camera {
+    Point position;
+    float verticalFov;    // degrees
+    float viewportHeight; // pixels
+
+    // Pixels covered by one world unit, seen face-on at a distance of one unit
+    float projectionScale() const {
+        return viewportHeight / (2.0f * std::tan(verticalFov / 2.0f / 57.2957795131f));
+    }
+};
+
+// Runtime LOD selection by screen-space error. For every object it projects the recorded geometric error of
+// each level to pixels at the distance of the object's bounding sphere and picks the coarsest level whose
+// error stays under the pixel tolerance. Per-object data is kept in parallel arrays so the projection step is
+// one tight loop over all objects.
+class LodSelector {
+public:
+    // pixelTolerance: largest acceptable on-screen error in pixels.
+    // hysteresis: a coarser level must beat the tolerance by this fraction before it is chosen, so objects
+    // hovering around a switching distance do not pop back and forth every frame.
+    LodSelector(float pixelTolerance = 1.0f, float hysteresis = 0.25f)
+        : pixelTolerance(pixelTolerance), hysteresis(hysteresis), tolerance(pixelTolerance) {}
+
+    // Function to register an object with its bounds and LOD chain; returns the object's index
+    size_t addObject(const BoundingSphere& bounds, const std::vector<LodLevel>& chain) {
+        centerX.push_back(bounds.center.x);
+        centerY.push_back(bounds.center.y);
+        centerZ.push_back(bounds.center.z);
+        radius.push_back(bounds.radius);
+        firstLevel.push_back(uint32_t(levelError.size()));
+        levelCount.push_back(uint32_t(chain.size()));
+        currentLevel.push_back(0);
+        for (const LodLevel& level : chain) {
+            levelError.push_back(level.geometricError);
+            levelTriangles.push_back(uint32_t(level.mesh.triangleCount()));
+        }
+        return centerX.size() - 1;
+    }
+
+    // Function to update the bounds of an object that moved
+    void setBounds(size_t object, const BoundingSphere& bounds) {
+        centerX[object] = bounds.center.x;
+        centerY[object] = bounds.center.y;
+        centerZ[object] = bounds.center.z;
+        radius[object] = bounds.radius;
+    }
+
+    // Cap on the total triangles selected per frame; 0 disables it. While over budget the tolerance is raised
+    // for everyone, and it relaxes back towards pixelTolerance once there is headroom again.
+    void setTriangleBudget(size_t triangles) { triangleBudget = triangles; }
+
+    size_t level(size_t object) const { return currentLevel[object]; }
+    float currentTolerance() const { return tolerance; }
+
+    // Function to choose a level for every object; returns the number of triangles selected
+    size_t select(const Camera& camera) {
+        const size_t count = centerX.size();
+        const float scale = camera.projectionScale();
+        const float camX = camera.position.x, camY = camera.position.y, camZ = camera.position.z;
+
+        // Pass 1: pixels per world unit at the nearest point of each bounding sphere. Branch-free over the
+        // SoA arrays so the compiler vectorizes it.
+        pixelsPerUnit.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            float dx = centerX[i] - camX, dy = centerY[i] - camY, dz = centerZ[i] - camZ;
+            float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - radius[i];
+            pixelsPerUnit[i] = scale / std::max(distance, NEAR_DISTANCE);
+        }
+
+        // Pass 2: walk each object's level from where it was last frame. Errors grow monotonically along a
+        // chain, so refining and coarsening are both short walks.
+        const float refineAbove = tolerance;
+        const float coarsenBelow = tolerance * (1.0f - hysteresis);
+        size_t triangles = 0;
+        bool canCoarsen = false;
+        for (size_t i = 0; i < count; ++i) {
+            const float* errors = &levelError[firstLevel[i]];
+            uint32_t level = currentLevel[i];
+            float ppu = pixelsPerUnit[i];
+            while (level > 0 && errors[level] * ppu > refineAbove) --level;
+            while (level + 1 < levelCount[i] && errors[level + 1] * ppu <= coarsenBelow) ++level;
+            currentLevel[i] = level;
+            triangles += levelTriangles[firstLevel[i] + level];
+            canCoarsen |= level + 1 < levelCount[i];
+        }
+
+        adjustToleranceForBudget(triangles, canCoarsen);
+        return triangles;
+    }
+
+private:
+    // Objects closer than this (or containing the camera) are treated as being at this distance
+    static constexpr float NEAR_DISTANCE = 0.01f;
+
+    // Function to nudge the global tolerance towards the triangle budget. Takes effect next frame; the step is
+    // limited so it converges over a few frames instead of oscillating. Once every object is at its coarsest
+    // level the budget cannot be met, and raising the tolerance further would only delay recovery.
+    void adjustToleranceForBudget(size_t triangles, bool canCoarsen) {
+        if (triangleBudget == 0) {
+            tolerance = pixelTolerance;
+            return;
+        }
+        float load = float(triangles) / float(triangleBudget);
+        if (load > 1.0f && canCoarsen) {
+            tolerance *= std::min(load, 1.25f);
+        } else if (load < 0.9f) {
+            tolerance = std::max(pixelTolerance, tolerance * std::max(load / 0.9f, 0.8f));
+        }
+    }
+
+    float pixelTolerance;
+    float hysteresis;
+    float tolerance;
+    size_t triangleBudget = 0;
+
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<uint32_t> firstLevel, levelCount, currentLevel;
+    std::vector<float> levelError;          // all chains back to back, indexed by firstLevel[i] + level
+    std::vector<uint32_t> levelTriangles;   // same layout as levelError
+    std::vector<float> pixelsPerUnit;       // per-frame scratch
+};
+
 int main() {
     sf::RenderWindow window(sf::VideoMode(800, 600), "Polygonal Modeler");
 
-    // Define points of the polygon
-    std::vector<Point> vertices = {{0.0f, 0.0f, -5.0f}, {2.0f, 0.0f, -5.0f}, {1.0f, 3.0f, -5.0f}, {0.0f, 4.0f,
--5.0f}};
+    // Build one full-detail model and its LOD chain, then place copies of it across the scene
+    Polygon prototype(makeBumpySphere(1.0f, 16, 32, Point(0.0f, 0.0f, 0.0f)));
+    prototype.generateLods({0.5f, 0.25f, 0.125f, 0.0625f});
 
-    Polygon polygon(vertices);
+    for (size_t i = 0; i < prototype.lodCount(); ++i) {
+        std::cout << "LOD " << i << ": " << prototype.lod(i).mesh.triangleCount() << " triangles, error "
+                  << prototype.lod(i).geometricError << std::endl;
+    }
+
+    std::vector<Polygon> polygons;
+    LodSelector selector(1.0f); // Change this value to trade detail for speed (pixels of error allowed)
+    for (int row = 0; row < 40; ++row) {
+        for (int column = 0; column < 25; ++column) {
+            polygons.push_back(prototype);
+            polygons.back().translate(column * 3.0f - 36.0f, 0.0f, -5.0f - row * 3.0f);
+            selector.addObject(polygons.back().boundingSphere(), prototype.lodChain());
+        }
+    }
+    selector.setTriangleBudget(150000);
+
+    Camera camera{Point(0.0f, 2.0f, 0.0f), 60.0f, 600.0f};
 
     // Main loop
+    int frame = 0;
     while (window.isOpen()) {
         sf::Event event;
         while (window.pollEvent(event)) {
@@ -109,23 +305,44 @@ int main() {
                 window.close();
         }
 
-        // Reduce polygon count based on distance from camera
-        float maxDistance = 10.0f; // Change this value to adjust the LOD threshold
-        polygon.reducePolygonCount(maxDistance);
+        // Fly the camera back and forth through the crowd
+        camera.position.z = -60.0f + 60.0f * std::cos(frame * 0.01f);
+
+        // Choose the level of detail for every object in one pass
+        size_t triangles = selector.select(camera);
+        if (frame % 120 == 0) {
+            std::cout << "Frame " << frame << ": " << triangles << " triangles at "
+                      << selector.currentTolerance() << " px tolerance" << std::endl;
+        }
 
         // Draw everything
         window.clear();
 
-        polygon.draw(window);
+        for (size_t i = 0; i < polygons.size(); ++i) {
+            polygons[i].setLod(selector.level(i));
+            polygons[i].draw(window);
+        }
         window.display();
+        ++frame;
     }
 
     return 0;
 }
 /*
-In this code, we've added a `reducePolygonCount` function to the Polygon class that reduces the number of
-vertices in the polygon based on its distance from the camera. The threshold value for reducing the polygon
-count can be adjusted using the `maxDistance` variable.
+In this code, the Polygon class holds a chain of levels of detail, built offline by `buildLodChain()`. The
+`MeshSimplifier`, which lives in mesh_simplifier.h so 3d_lod_example_2.cpp can use it too, collapses edges in order
+of their quadric error (the summed squared distance to the planes of the original triangles that were merged into a
+vertex), using a priority queue, so removing n triangles costs O(n log n). Vertices on UV seams are locked and
+vertices on open borders can only slide along the border, so texturing and silhouettes survive simplification. Each
+level records its geometric error, a world-space bound on how far it deviates from the full-detail mesh. The
+quadric cost only decides the order of the collapses; the recorded error is measured after simplifying, as the
+largest distance from an original vertex to the triangles around the vertex it was merged into.
+
+At runtime the `LodSelector` uses that error instead of a fixed distance threshold. It projects each level's
+error to pixels at the nearest point of the object's bounding sphere and picks the coarsest level that stays
+under a pixel tolerance. A coarser level must beat the tolerance by a margin (hysteresis) before it is chosen, so
+objects near a switching distance do not pop. Object data is stored as parallel arrays and processed in one batch
+per frame, and an optional triangle budget raises the tolerance for the whole scene while it is exceeded.
 
 When you run the program, you'll see that as you approach the camera, the polygon count decreases, resulting in
 a smoother rendering performance. You can modify this code to suit your specific requirements and experiment
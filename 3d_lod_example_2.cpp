@@ -0,0 +1,426 @@
+/* Here's an example of a progressive mesh in C++: instead of a few fixed levels of detail, a model is stored as
+a coarse base mesh plus a stream of refinements that can be applied one at a time.
+*/
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+#include "mesh_simplifier.h"
+
+// Refinement record: re-inserts one vertex that was collapsed into 'parent'. Vertex splits are numbered in the
+// order they are applied, and split i always creates vertex baseVertexCount + i.
+struct VertexSplit {
+    unsigned parent;                   // existing vertex the new vertex was merged into
+    Point position;
+    TexCoord texCoord;
+    std::vector<unsigned> corners;     // triangle * 3 + slot entries that switch from parent to the new vertex
+    std::vector<unsigned> newTriangles; // three indices per triangle appended by the split
+};
+
+// Progressive mesh (Hoppe): a coarse base mesh plus an ordered list of vertex splits. Applying splits refines
+// the mesh one vertex at a time, undoing them coarsens it again, so any triangle count between the base and the
+// full-detail mesh can be reached incrementally. Triangles are only ever appended or popped at the end, so the
+// current mesh is always a valid indexed triangle list that can be drawn as is.
+class ProgressiveMesh {
+public:
+    ProgressiveMesh() = default;
+
+    // Function to start over from a base mesh; any previously loaded splits are discarded
+    void setBase(const TriangleMesh& base) {
+        current = base;
+        baseVertexCount = base.positions.size();
+        baseTriangleCount = base.triangleCount();
+        splits.clear();
+        applied = 0;
+    }
+
+    // Function to make one more split available (e.g. as it arrives from a file); does not apply it
+    void appendSplit(VertexSplit split) { splits.push_back(std::move(split)); }
+
+    const TriangleMesh& mesh() const { return current; }
+    size_t triangleCount() const { return current.triangleCount(); }
+    size_t appliedSplits() const { return applied; }
+    size_t loadedSplits() const { return splits.size(); }
+    const std::vector<VertexSplit>& splitRecords() const { return splits; }
+    size_t baseVertices() const { return baseVertexCount; }
+    size_t baseTriangles() const { return baseTriangleCount; }
+
+    // Function to apply the next loaded split; returns false when there is none
+    bool refine() {
+        if (applied == splits.size()) return false;
+        const VertexSplit& split = splits[applied];
+        unsigned vertex = unsigned(current.positions.size());
+        current.positions.push_back(split.position);
+        current.texCoords.push_back(split.texCoord);
+        for (unsigned c : split.corners) current.indices[c] = vertex;
+        current.indices.insert(current.indices.end(), split.newTriangles.begin(), split.newTriangles.end());
+        ++applied;
+        return true;
+    }
+
+    // Function to undo the most recent split; returns false at the base mesh
+    bool coarsen() {
+        if (applied == 0) return false;
+        const VertexSplit& split = splits[applied - 1];
+        current.indices.resize(current.indices.size() - split.newTriangles.size());
+        for (unsigned c : split.corners) current.indices[c] = split.parent;
+        current.positions.pop_back();
+        current.texCoords.pop_back();
+        --applied;
+        return true;
+    }
+
+    // Function to refine or coarsen to the largest triangle count not above target (or the base mesh)
+    void setTriangleCount(size_t target) {
+        while (triangleCount() > target && coarsen()) {}
+        while (applied < splits.size() && triangleCount() + splits[applied].newTriangles.size() / 3 <= target) {
+            refine();
+        }
+    }
+
+    void coarsenToBase() { while (coarsen()) {} }
+
+private:
+    TriangleMesh current;
+    size_t baseVertexCount = 0;
+    size_t baseTriangleCount = 0;
+    std::vector<VertexSplit> splits;
+    size_t applied = 0;
+};
+
+// Function to turn a full-detail mesh into a progressive mesh. The mesh is simplified as far as it will go while
+// logging every collapse; what is left becomes the base mesh and the log, replayed backwards, becomes the split
+// list. Vertices and triangles are renumbered into the order in which splits create them.
+ProgressiveMesh buildProgressiveMesh(const TriangleMesh& mesh) {
+    MeshSimplifier simplifier(mesh);
+    simplifier.simplifyTo(0);
+
+    std::vector<unsigned> vertexOrder(mesh.positions.size(), ~0u);
+    std::vector<unsigned> triangleOrder(mesh.triangleCount(), ~0u);
+
+    TriangleMesh base;
+    for (unsigned v = 0; v < mesh.positions.size(); ++v) {
+        if (simplifier.isVertexRemoved(v)) continue;
+        vertexOrder[v] = unsigned(base.positions.size());
+        base.positions.push_back(mesh.positions[v]);
+        base.texCoords.push_back(mesh.texCoords[v]);
+    }
+    unsigned nextTriangle = 0;
+    for (unsigned t = 0; t < mesh.triangleCount(); ++t) {
+        if (!simplifier.isTriangleAlive(t)) continue;
+        triangleOrder[t] = nextTriangle++;
+        for (int k = 0; k < 3; ++k) base.indices.push_back(vertexOrder[simplifier.corner(t, k)]);
+    }
+
+    ProgressiveMesh result;
+    result.setBase(base);
+
+    // Undoing collapses newest first rebuilds the mesh exactly as it was before each one
+    unsigned nextVertex = unsigned(base.positions.size());
+    const std::vector<MeshSimplifier::CollapseRecord>& history = simplifier.history();
+    for (auto record = history.rbegin(); record != history.rend(); ++record) {
+        VertexSplit split;
+        vertexOrder[record->from] = nextVertex++;
+        split.parent = vertexOrder[record->to];
+        split.position = mesh.positions[record->from];
+        split.texCoord = mesh.texCoords[record->from];
+        for (unsigned c : record->changedCorners) {
+            split.corners.push_back(triangleOrder[c / 3] * 3 + c % 3);
+        }
+        for (unsigned t : record->removedTriangles) {
+            triangleOrder[t] = nextTriangle++;
+            for (int k = 0; k < 3; ++k) split.newTriangles.push_back(vertexOrder[simplifier.corner(t, k)]);
+        }
+        result.appendSplit(std::move(split));
+    }
+    return result;
+}
+
+// File layout, little-endian, laid out so a reader can stop after any prefix and still draw what it has:
+//   header:  "PMSH", version, base vertex count, base triangle count, split count, full triangle count
+//            (6 x uint32)
+//   base:    vertices as x, y, z, u, v (float32), then triangles as 3 x uint32
+//   splits:  parent (uint32), x, y, z, u, v (float32), corner count, triangle count (uint16 each),
+//            corners (uint32 each), triangle indices (3 x uint32 each)
+const uint32_t PROGRESSIVE_MESH_MAGIC = 0x48534D50; // "PMSH"
+const uint32_t PROGRESSIVE_MESH_VERSION = 2;
+const size_t VERTEX_BYTES = 5 * sizeof(float);
+const size_t MAX_SPLIT_ENTRIES = 0xFFFF; // corner and triangle counts of a split are stored as uint16
+
+// Values are written byte by byte from the lowest, so files are little-endian whatever the host's byte order
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+    static_assert(sizeof(T) == 2 || sizeof(T) == 4, "only 16- and 32-bit values are stored");
+    using Bits = typename std::conditional<sizeof(T) == 2, uint16_t, uint32_t>::type;
+    Bits bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) bytes[i] = char((bits >> (8 * i)) & 0xFF);
+    out.write(bytes, sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+    static_assert(sizeof(T) == 2 || sizeof(T) == 4, "only 16- and 32-bit values are stored");
+    using Bits = typename std::conditional<sizeof(T) == 2, uint16_t, uint32_t>::type;
+    unsigned char bytes[sizeof(T)];
+    if (!in.read(reinterpret_cast<char*>(bytes), sizeof(T))) return false;
+    Bits bits = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) bits = Bits(bits | Bits(bytes[i]) << (8 * i));
+    std::memcpy(&value, &bits, sizeof(T));
+    return true;
+}
+
+void writeVertex(std::ostream& out, const Point& p, const TexCoord& uv) {
+    for (float value : {p.x, p.y, p.z, uv.u, uv.v}) writeValue(out, value);
+}
+
+bool readVertex(std::istream& in, Point& p, TexCoord& uv) {
+    float values[5];
+    for (float& value : values) {
+        if (!readValue(in, value)) return false;
+    }
+    p = Point(values[0], values[1], values[2]);
+    uv = {values[3], values[4]};
+    return true;
+}
+
+void writeIndices(std::ostream& out, const std::vector<unsigned>& indices) {
+    for (unsigned index : indices) writeValue(out, uint32_t(index));
+}
+
+// Function to append count indices from the stream. The vector only grows as the data actually arrives, so a
+// corrupt count fails at the end of the file instead of allocating for it up front.
+bool readIndices(std::istream& in, std::vector<unsigned>& indices, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t index;
+        if (!readValue(in, index)) return false;
+        indices.push_back(index);
+    }
+    return true;
+}
+
+// Function to find how many bytes are left in a stream, or the largest value if the stream cannot tell (a pipe)
+uint64_t remainingBytes(std::istream& in) {
+    std::istream::pos_type here = in.tellg();
+    if (here == std::istream::pos_type(-1)) return UINT64_MAX;
+    in.seekg(0, std::ios::end);
+    std::istream::pos_type end = in.tellg();
+    in.clear();
+    in.seekg(here);
+    if (end == std::istream::pos_type(-1) || end < here) return UINT64_MAX;
+    return uint64_t(end - here);
+}
+
+// Function to save a progressive mesh (base mesh followed by every loaded split). Fails for a split that
+// touches more corners or triangles than its uint16 counts can hold.
+bool writeProgressiveMesh(std::ostream& out, const ProgressiveMesh& progressive) {
+    ProgressiveMesh base = progressive;
+    base.coarsenToBase();
+    const TriangleMesh& mesh = base.mesh();
+
+    size_t fullTriangles = mesh.triangleCount();
+    for (const VertexSplit& split : base.splitRecords()) {
+        if (split.corners.size() > MAX_SPLIT_ENTRIES || split.newTriangles.size() / 3 > MAX_SPLIT_ENTRIES)
+            return false;
+        fullTriangles += split.newTriangles.size() / 3;
+    }
+
+    writeValue(out, PROGRESSIVE_MESH_MAGIC);
+    writeValue(out, PROGRESSIVE_MESH_VERSION);
+    writeValue(out, uint32_t(mesh.positions.size()));
+    writeValue(out, uint32_t(mesh.triangleCount()));
+    writeValue(out, uint32_t(base.loadedSplits()));
+    writeValue(out, uint32_t(fullTriangles));
+
+    for (size_t v = 0; v < mesh.positions.size(); ++v) writeVertex(out, mesh.positions[v], mesh.texCoords[v]);
+    writeIndices(out, mesh.indices);
+
+    for (const VertexSplit& split : base.splitRecords()) {
+        writeValue(out, uint32_t(split.parent));
+        writeVertex(out, split.position, split.texCoord);
+        writeValue(out, uint16_t(split.corners.size()));
+        writeValue(out, uint16_t(split.newTriangles.size() / 3));
+        writeIndices(out, split.corners);
+        writeIndices(out, split.newTriangles);
+    }
+    return bool(out);
+}
+
+// Reads a progressive mesh file front to back in pieces: first the header and base mesh, which are enough to
+// draw the object, then vertex splits in batches of any size. Counts are checked against the size of the file
+// and indices are validated as they are read, so a truncated or corrupt file stops cleanly instead of
+// corrupting the mesh.
+class ProgressiveMeshReader {
+public:
+    explicit ProgressiveMeshReader(std::istream& in) : in(in) {}
+
+    // Function to read the header and base mesh into 'mesh'; returns false if the file is not valid
+    bool readBase(ProgressiveMesh& mesh) {
+        uint32_t magic, version, vertexCount, triangleCount;
+        if (!readValue(in, magic) || !readValue(in, version) || !readValue(in, vertexCount) ||
+            !readValue(in, triangleCount) || !readValue(in, splitCount) || !readValue(in, fullTriangles))
+            return false;
+        if (magic != PROGRESSIVE_MESH_MAGIC || version != PROGRESSIVE_MESH_VERSION) return false;
+        uint64_t baseBytes = uint64_t(vertexCount) * VERTEX_BYTES + uint64_t(triangleCount) * 3 * sizeof(uint32_t);
+        if (baseBytes > remainingBytes(in)) return false;
+
+        TriangleMesh base;
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            Point position;
+            TexCoord texCoord;
+            if (!readVertex(in, position, texCoord)) return false;
+            base.positions.push_back(position);
+            base.texCoords.push_back(texCoord);
+        }
+        if (!readIndices(in, base.indices, size_t(triangleCount) * 3)) return false;
+        for (unsigned index : base.indices) {
+            if (index >= vertexCount) return false;
+        }
+
+        mesh.setBase(base);
+        vertexTotal = vertexCount;
+        cornerTotal = base.indices.size();
+        splitsRead = 0;
+        return true;
+    }
+
+    // Function to read up to maxSplits further splits into 'mesh'; returns how many were read
+    size_t readSplits(ProgressiveMesh& mesh, size_t maxSplits) {
+        size_t count = 0;
+        while (count < maxSplits && splitsRead < splitCount) {
+            VertexSplit split;
+            uint32_t parent;
+            uint16_t cornerCount, newTriangleCount;
+            bool ok = readValue(in, parent) && readVertex(in, split.position, split.texCoord) &&
+                      readValue(in, cornerCount) && readValue(in, newTriangleCount) &&
+                      readIndices(in, split.corners, cornerCount) &&
+                      readIndices(in, split.newTriangles, size_t(newTriangleCount) * 3);
+            split.parent = parent;
+            ok = ok && parent < vertexTotal;
+            for (unsigned c : split.corners) ok = ok && c < cornerTotal;
+            for (unsigned index : split.newTriangles) ok = ok && index <= vertexTotal;
+            if (!ok) {
+                splitCount = splitsRead; // truncated or corrupt: keep what we have
+                break;
+            }
+
+            ++vertexTotal;
+            cornerTotal += split.newTriangles.size();
+            mesh.appendSplit(std::move(split));
+            ++splitsRead;
+            ++count;
+        }
+        return count;
+    }
+
+    bool finished() const { return splitsRead == splitCount; }
+
+    // Triangles of the mesh once every split in the file is applied, known as soon as the header is read
+    size_t fullTriangleCount() const { return fullTriangles; }
+
+private:
+    std::istream& in;
+    uint32_t splitCount = 0;
+    uint32_t splitsRead = 0;
+    uint32_t fullTriangles = 0;
+    size_t vertexTotal = 0; // vertices that exist once every split read so far is applied
+    size_t cornerTotal = 0; // likewise for triangle corners
+};
+
+// Define a Polygon class backed by a progressive mesh instead of discrete LOD levels
+class Polygon {
+private:
+    ProgressiveMesh mesh;
+
+public:
+    ProgressiveMesh& progressiveMesh() { return mesh; }
+
+    // Function to show as close to the requested number of triangles as the loaded splits allow
+    void setTriangleCount(size_t triangles) { mesh.setTriangleCount(triangles); }
+
+    // Function to draw the polygon in SFML window
+    void draw(sf::RenderWindow& window) {
+        const TriangleMesh& current = mesh.mesh();
+        for (size_t i = 0; i < current.indices.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                const Point& a = current.positions[current.indices[i + k]];
+                const Point& b = current.positions[current.indices[i + (k + 1) % 3]];
+                sf::Vertex line[] = {{a.x, a.y, a.z}, {b.x, b.y, b.z}};
+                window.draw(line, 2, sf::Lines);
+            }
+        }
+    }
+};
+
+int main() {
+    // Offline step: turn the full-detail model into a progressive mesh file
+    {
+        ProgressiveMesh progressive = buildProgressiveMesh(makeBumpySphere(2.0f, 64, 128, Point(0.0f, 0.0f, -5.0f)));
+        std::ofstream out("model.pm", std::ios::binary);
+        if (!writeProgressiveMesh(out, progressive)) {
+            std::cout << "Could not write model.pm" << std::endl;
+            return 1;
+        }
+    }
+
+    sf::RenderWindow window(sf::VideoMode(800, 600), "Polygonal Modeler");
+
+    // Load only the base mesh before the first frame; detail streams in while we are already drawing
+    std::ifstream in("model.pm", std::ios::binary);
+    ProgressiveMeshReader reader(in);
+    Polygon polygon;
+    if (!reader.readBase(polygon.progressiveMesh())) {
+        std::cout << "model.pm is not a valid progressive mesh" << std::endl;
+        return 1;
+    }
+    std::cout << "Drawable after " << in.tellg() << " bytes: " << polygon.progressiveMesh().triangleCount()
+              << " triangles" << std::endl;
+
+    // Main loop
+    int frame = 0;
+    while (window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed)
+                window.close();
+        }
+
+        // Stream a batch of vertex splits per frame until the whole file is in
+        if (!reader.finished()) {
+            reader.readSplits(polygon.progressiveMesh(), 500);
+        }
+
+        // Pick a triangle count from the (animated) distance; any count is reachable, not just fixed levels
+        float distance = 10.0f + 40.0f * (0.5f + 0.5f * std::sin(frame * 0.01f));
+        float maxDistance = 10.0f; // Full detail at or closer than this distance
+        float detail = std::min(1.0f, (maxDistance / distance) * (maxDistance / distance));
+        polygon.setTriangleCount(size_t(reader.fullTriangleCount() * detail));
+
+        // Draw everything
+        window.clear();
+
+        polygon.draw(window);
+        window.display();
+        ++frame;
+    }
+
+    return 0;
+}
+/*
+This example is an alternative to the discrete LOD levels of 3d_lod_example_1.cpp. The full-detail mesh is
+simplified offline by edge collapses, with the `MeshSimplifier` of mesh_simplifier.h, and each collapse is logged.
+Played backwards, the log becomes a list of vertex splits: each split re-inserts one vertex, moves a few triangle
+corners onto it and appends the one or two triangles the collapse removed. The `ProgressiveMesh` class applies or
+undoes splits one at a time, so the mesh can be set to any triangle count, and changes between nearby counts cost
+only a few index writes.
+
+The file format puts the coarse base mesh first and the splits after it in the order they are applied. A reader
+can therefore draw the object as soon as the first few kilobytes are loaded and keep refining it while the rest
+of the file streams in, which shortens the time to the first frame for large scenes.
+*/
\ No newline at end of file
@@ -1,79 +1,576 @@
 /*
 Here's an example of a C++ program that demonstrates more complex memory management scenarios, including:
 
-1.  **Dynamic memory allocation**: Creating and managing objects with dynamic memory allocation using `new` and
-`delete`.
+1.  **Handle-based object storage**: Keeping scene objects densely in a slot map and referring to them through
+generational handles instead of pointers to individually allocated objects.
 2.  **Smart pointers with shared ownership**: Using multiple smart pointers to share ownership of the same
 object, demonstrating how to avoid duplicate deletion.
 3.  **Stack-based vs. heap-based memory allocation**: Showing how to allocate memory on the stack versus the
 heap using `std::array` and `std::vector`.
-4.  **Memory fragmentation prevention**: Implementing a simple memory management algorithm that prevents memory
-fragmentation in a dynamic memory allocation system.
+4.  **Memory fragmentation prevention**: A pool allocator that serves small objects from fixed-size blocks in
+power-of-two size classes, so churning small allocations cannot fragment the heap.
 */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
 #include <vector>
+#include "slot_map.h"
 
-// Define a class to demonstrate dynamic memory allocation
-class DynamicObject {
+// Define a scene object. It is a plain value: the slot map owns it, so it needs no heap allocation of its own
+struct DynamicObject {
+    int id = 0;
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    float vx = 0.0f, vy = 0.0f, vz = 0.0f;
+};
+
+// Live counters of a PoolAllocator
+struct PoolStats {
+    size_t bytesRequested = 0; // bytes callers asked for and still hold
+    size_t bytesInUse = 0;     // bytes of the blocks handed out for them (including size-class rounding)
+    size_t bytesReserved = 0;  // bytes obtained from the upstream resource (slabs and large blocks)
+    size_t largeBlocks = 0;    // live allocations too big for any size class
+    size_t largeBytes = 0;
+
+    // Share of in-use memory lost to rounding requests up to their size class
+    double internalFragmentation() const {
+        return bytesInUse == 0 ? 0.0 : 1.0 - double(bytesRequested) / double(bytesInUse);
+    }
+
+    // Share of reserved memory that is not handed out (free blocks and uncarved slab space)
+    double externalFragmentation() const {
+        return bytesReserved == 0 ? 0.0 : 1.0 - double(bytesInUse) / double(bytesReserved);
+    }
+};
+
+// Occupancy of one size class
+struct SizeClassStats {
+    size_t blockSize = 0;
+    size_t blocksInUse = 0;
+    size_t blocksCarved = 0; // blocks cut from slabs so far; in use or on the free list
+
+    double occupancy() const { return blocksCarved == 0 ? 0.0 : double(blocksInUse) / double(blocksCarved); }
+};
+
+// Define a pool allocator for small objects. Requests are rounded up to a power-of-two size class between 8 bytes
+// and 4 KiB; each class carves fixed-size blocks out of 64 KiB slabs and keeps freed blocks on an intrusive free
+// list (the link is stored inside the free block itself), so allocate and free are a few pointer operations and a
+// freed block is always reusable by the next request of its class. Larger requests go straight to the upstream
+// resource. Usable anywhere a std::pmr::memory_resource is accepted. Not thread-safe.
+class PoolAllocator : public std::pmr::memory_resource {
 public:
-    DynamicObject() : id_(new int) {}
-    ~DynamicObject() { delete id_; }
+    static constexpr size_t MIN_BLOCK_SIZE = 8;
+    static constexpr size_t MAX_BLOCK_SIZE = 4096;
+    static constexpr size_t CLASS_COUNT = 10; // 8, 16, ..., 4096
+    static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+    explicit PoolAllocator(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream(upstream) {
+        for (size_t i = 0; i < CLASS_COUNT; ++i) classes[i].blockSize = MIN_BLOCK_SIZE << i;
+    }
+
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+    // Slabs are returned in one go; large blocks still outstanding belong to their owners
+    ~PoolAllocator() override {
+        for (void* slab : slabs) upstream->deallocate(slab, SLAB_SIZE, MAX_BLOCK_SIZE);
+    }
+
+    const PoolStats& stats() const { return totals; }
+
+    // Function to map a request to its size class, or -1 if it is served by the upstream resource. A class is
+    // at least as large as the alignment: slabs are aligned to MAX_BLOCK_SIZE, so every block is aligned to its
+    // own size.
+    static int classIndex(size_t bytes, size_t alignment) {
+        size_t size = std::max({bytes, alignment, MIN_BLOCK_SIZE});
+        if (size > MAX_BLOCK_SIZE) return -1;
+        int index = 0;
+        while ((MIN_BLOCK_SIZE << index) < size) ++index;
+        return index;
+    }
+
+    SizeClassStats classStats(size_t index) const {
+        const SizeClass& c = classes[index];
+        return {c.blockSize, c.blocksInUse, c.blocksCarved};
+    }
+
+    // Function to print the current metrics, one line per size class that has been used
+    void printReport(std::ostream& out) const {
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << "Pool: " << totals.bytesInUse << " bytes in use (" << totals.bytesRequested << " requested), "
+            << totals.bytesReserved << " reserved, " << totals.largeBlocks << " large blocks" << std::endl;
+        out << std::fixed << std::setprecision(1) << "  internal fragmentation "
+            << 100.0 * totals.internalFragmentation() << "%, external fragmentation "
+            << 100.0 * totals.externalFragmentation() << "%" << std::endl;
+        for (size_t i = 0; i < CLASS_COUNT; ++i) {
+            SizeClassStats c = classStats(i);
+            if (c.blocksCarved == 0) continue;
+            out << "  " << std::setw(4) << c.blockSize << " B: " << c.blocksInUse << "/" << c.blocksCarved
+                << " blocks (" << 100.0 * c.occupancy() << "%)" << std::endl;
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        int index = classIndex(bytes, alignment);
+        if (index < 0) {
+            void* p = upstream->allocate(bytes, alignment);
+            totals.largeBlocks += 1;
+            totals.largeBytes += bytes;
+            totals.bytesRequested += bytes;
+            totals.bytesInUse += bytes;
+            totals.bytesReserved += bytes;
+            return p;
+        }
+
+        SizeClass& c = classes[index];
+        void* p;
+        if (c.freeList) {
+            p = c.freeList;
+            c.freeList = c.freeList->next;
+        } else {
+            if (c.carveCursor == c.carveEnd) addSlab(c);
+            p = c.carveCursor;
+            c.carveCursor += c.blockSize;
+            ++c.blocksCarved;
+        }
+        ++c.blocksInUse;
+        totals.bytesRequested += bytes;
+        totals.bytesInUse += c.blockSize;
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        int index = classIndex(bytes, alignment);
+        if (index < 0) {
+            upstream->deallocate(p, bytes, alignment);
+            totals.largeBlocks -= 1;
+            totals.largeBytes -= bytes;
+            totals.bytesRequested -= bytes;
+            totals.bytesInUse -= bytes;
+            totals.bytesReserved -= bytes;
+            return;
+        }
+
+        SizeClass& c = classes[index];
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        block->next = c.freeList;
+        c.freeList = block;
+        --c.blocksInUse;
+        totals.bytesRequested -= bytes;
+        totals.bytesInUse -= c.blockSize;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
 
 private:
-    std::unique_ptr<int> id_;
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SizeClass {
+        size_t blockSize = 0;
+        FreeBlock* freeList = nullptr;
+        char* carveCursor = nullptr; // uncarved space in the newest slab of this class
+        char* carveEnd = nullptr;
+        size_t blocksInUse = 0;
+        size_t blocksCarved = 0;
+    };
+
+    void addSlab(SizeClass& c) {
+        char* slab = static_cast<char*>(upstream->allocate(SLAB_SIZE, MAX_BLOCK_SIZE));
+        slabs.push_back(slab);
+        c.carveCursor = slab;
+        c.carveEnd = slab + SLAB_SIZE;
+        totals.bytesReserved += SLAB_SIZE;
+    }
+
+    std::pmr::memory_resource* upstream;
+    std::array<SizeClass, CLASS_COUNT> classes;
+    std::vector<void*> slabs;
+    PoolStats totals;
 };
 
-int main() {
-    // Allocate memory on the heap using new
-    auto heapAllocated = new DynamicObject();
+// Define the shared back end of the thread caches: a PoolAllocator behind a mutex plus a depot of magazines, i.e.
+// fixed-size stacks of free blocks of one size class. Thread caches exchange whole magazines with the depot, so
+// the lock is taken once per MAGAZINE_SIZE allocations or frees instead of once per call.
+class PoolDepot {
+public:
+    static constexpr size_t MAGAZINE_SIZE = 64;
 
-    // Use shared ownership with a unique_ptr and a reference to a local variable
-    auto sharedOwnership = std::make_unique<DynamicObject>();
-    int& localRef = *sharedOwnership;
+    struct Magazine {
+        size_t count = 0;
+        void* blocks[MAGAZINE_SIZE];
+    };
 
-    // Accessing the object through both methods
-    heapAllocated->id_->value = 1;
-    sharedOwnership->id_->value = 2;  // Note: this will not modify localRef
+    PoolDepot() = default;
+    PoolDepot(const PoolDepot&) = delete;
+    PoolDepot& operator=(const PoolDepot&) = delete;
 
-    // Memory allocation on the stack using std::array
-    std::array<int, 3> stackAllocated = {10, 20, 30};
+    // Function to trade an empty magazine for one holding free blocks, filling it from the pool if the depot has
+    // none of this class
+    Magazine* exchangeEmpty(size_t classIndex, Magazine* empty) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Magazine*>& full = fullMagazines[classIndex];
+        if (!full.empty()) {
+            Magazine* m = full.back();
+            full.pop_back();
+            emptyMagazines.push_back(empty);
+            return m;
+        }
+        size_t blockSize = PoolAllocator::MIN_BLOCK_SIZE << classIndex;
+        for (size_t i = 0; i < MAGAZINE_SIZE; ++i) empty->blocks[i] = pool.allocate(blockSize, blockSize);
+        empty->count = MAGAZINE_SIZE;
+        ++refills;
+        return empty;
+    }
 
-    // Memory fragmentation prevention algorithm (simplified)
-    class MemoryAllocator {
-       public:
-        void allocate(int size) {
-            // Simple memory pool with fixed capacity and block sizes
-            data_.push_back(std::vector<int>(size, 0));
+    // Function to trade a full magazine for an empty one
+    Magazine* exchangeFull(size_t classIndex, Magazine* full) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fullMagazines[classIndex].push_back(full);
+        ++flushes;
+        return takeEmptyLocked();
+    }
+
+    Magazine* takeEmpty() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return takeEmptyLocked();
+    }
+
+    // Function to take back the magazines of a retiring thread cache; partly filled ones are kept as they are
+    void returnMagazine(size_t classIndex, Magazine* m) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (m->count == 0) {
+            emptyMagazines.push_back(m);
+        } else {
+            fullMagazines[classIndex].push_back(m);
         }
+    }
+
+    // Requests too large for a size class skip the magazines
+    void* allocateLarge(size_t bytes, size_t alignment) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pool.allocate(bytes, alignment);
+    }
 
-        int getAllocationSize() const { return data_.back().size(); }
-        bool isMemoryFragmented() const { return data_.empty(); }
+    void deallocateLarge(void* p, size_t bytes, size_t alignment) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pool.deallocate(p, bytes, alignment);
+    }
+
+    size_t refillCount() const { return refills; }
+    size_t flushCount() const { return flushes; }
+
+    // Blocks parked in magazines count as in use from the pool's point of view
+    void printReport(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        out << "Depot: " << refills << " refills from the pool, " << flushes << " magazines flushed, "
+            << magazines.size() << " magazines" << std::endl;
+        pool.printReport(out);
+    }
+
+private:
+    Magazine* takeEmptyLocked() {
+        if (emptyMagazines.empty()) {
+            magazines.push_back(std::make_unique<Magazine>());
+            return magazines.back().get();
+        }
+        Magazine* m = emptyMagazines.back();
+        emptyMagazines.pop_back();
+        return m;
+    }
 
-       private:
-        std::vector<std::vector<int>> data_;
+    std::mutex mutex;
+    PoolAllocator pool;
+    std::vector<std::unique_ptr<Magazine>> magazines; // every magazine ever created; held by a cache or listed below
+    std::array<std::vector<Magazine*>, PoolAllocator::CLASS_COUNT> fullMagazines;
+    std::vector<Magazine*> emptyMagazines;
+    size_t refills = 0;
+    size_t flushes = 0;
+};
+
+// Define the per-thread front end of the pool. Each worker creates its own ThreadCache and hands it to its
+// std::pmr containers. Per size class the cache keeps two magazines, so alternating allocate and free never
+// reaches the depot, and running out or overflowing costs one magazine exchange with the depot.
+// A block freed by another thread (a container moved to a different worker) is pushed onto a lock-free list of
+// the owning cache with a single compare-and-swap; the owner collects those blocks when its magazines run dry.
+// The cache must be created and destroyed on the thread that owns it, and outlive the memory it handed out.
+class ThreadCache : public std::pmr::memory_resource {
+public:
+    explicit ThreadCache(PoolDepot& depot) : depot(depot), owner(currentThread()) {
+        for (Slot& slot : slots) {
+            slot.loaded = depot.takeEmpty();
+            slot.previous = depot.takeEmpty();
+        }
+    }
+
+    ThreadCache(const ThreadCache&) = delete;
+    ThreadCache& operator=(const ThreadCache&) = delete;
+
+    ~ThreadCache() override {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            collectRemoteFrees(i);
+            depot.returnMagazine(i, slots[i].loaded);
+            depot.returnMagazine(i, slots[i].previous);
+        }
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        int index = PoolAllocator::classIndex(bytes, alignment);
+        if (index < 0) return depot.allocateLarge(bytes, alignment);
+
+        Slot& slot = slots[index];
+        if (slot.loaded->count == 0) {
+            if (slot.previous->count > 0) {
+                std::swap(slot.loaded, slot.previous);
+            } else {
+                collectRemoteFrees(index);
+                if (slot.loaded->count == 0) slot.loaded = depot.exchangeEmpty(index, slot.loaded);
+            }
+        }
+        return slot.loaded->blocks[--slot.loaded->count];
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        int index = PoolAllocator::classIndex(bytes, alignment);
+        if (index < 0) {
+            depot.deallocateLarge(p, bytes, alignment);
+        } else if (currentThread() == owner) {
+            push(index, p);
+        } else {
+            RemoteBlock* block = static_cast<RemoteBlock*>(p);
+            std::atomic<RemoteBlock*>& head = remoteFrees[index];
+            block->next = head.load(std::memory_order_relaxed);
+            while (!head.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+            }
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    struct Slot {
+        PoolDepot::Magazine* loaded;
+        PoolDepot::Magazine* previous;
+    };
+
+    struct RemoteBlock {
+        RemoteBlock* next;
     };
 
-    MemoryAllocator allocator;
-    allocator.allocate(10);
-    allocator.allocate(20);
+    // The address of a thread-local variable identifies the calling thread more cheaply than std::thread::id
+    static const void* currentThread() {
+        static thread_local char marker;
+        return &marker;
+    }
 
-    // Using the allocator to prevent memory fragmentation
-    if (allocator.getAllocationSize() < 30) {
-        allocator.allocate(10);  // Add more free space to the pool
+    void push(size_t index, void* p) {
+        Slot& slot = slots[index];
+        if (slot.loaded->count == PoolDepot::MAGAZINE_SIZE) {
+            if (slot.previous->count == PoolDepot::MAGAZINE_SIZE) {
+                slot.previous = depot.exchangeFull(index, slot.previous);
+            }
+            std::swap(slot.loaded, slot.previous);
+        }
+        slot.loaded->blocks[slot.loaded->count++] = p;
     }
-    if (allocator.isMemoryFragmented()) {
-        std::cout << "Memory is not fragmented." << std::endl;
+
+    // Taking the whole list at once means the list is only ever pushed to concurrently, so there is no ABA problem
+    void collectRemoteFrees(size_t index) {
+        RemoteBlock* block = remoteFrees[index].exchange(nullptr, std::memory_order_acquire);
+        while (block) {
+            RemoteBlock* next = block->next;
+            push(index, block);
+            block = next;
+        }
+    }
+
+    PoolDepot& depot;
+    const void* owner;
+    std::array<Slot, PoolAllocator::CLASS_COUNT> slots;
+    std::array<std::atomic<RemoteBlock*>, PoolAllocator::CLASS_COUNT> remoteFrees{};
+};
+
+// Function to measure allocation throughput with a given number of workers. Each worker keeps a window of live
+// blocks of mixed sizes and replaces the oldest one on every step, then frees a batch of blocks allocated by its
+// neighbour to exercise the cross-thread path. With useCaches == false every call goes through one mutex-guarded
+// pool instead, for comparison. Returns millions of allocate/free pairs per second.
+double runAllocatorStress(unsigned threadCount, bool useCaches, size_t stepsPerThread = 1000000) {
+    const size_t WINDOW = 256;
+    const size_t HANDOFF = 4096;
+    PoolDepot depot;
+    PoolAllocator lockedPool;
+    std::mutex lockedPoolMutex;
+
+    struct Block {
+        void* p;
+        size_t size;
+    };
+    std::vector<std::vector<Block>> handoff(threadCount);
+    std::vector<ThreadCache*> caches(threadCount, nullptr);
+    std::atomic<unsigned> arrived{0};
+    auto barrier = [&](unsigned phase) {
+        arrived.fetch_add(1);
+        while (arrived.load() < threadCount * phase) std::this_thread::yield();
+    };
+
+    auto worker = [&](unsigned t) {
+        ThreadCache cache(depot);
+        caches[t] = &cache;
+        auto allocate = [&](size_t size) {
+            if (useCaches) return cache.allocate(size);
+            std::lock_guard<std::mutex> lock(lockedPoolMutex);
+            return lockedPool.allocate(size);
+        };
+        auto deallocate = [&](ThreadCache* owner, void* p, size_t size) {
+            if (useCaches) return owner->deallocate(p, size);
+            std::lock_guard<std::mutex> lock(lockedPoolMutex);
+            lockedPool.deallocate(p, size);
+        };
+
+        std::array<Block, WINDOW> window{};
+        uint32_t random = 0x9E3779B9u * (t + 1);
+        for (size_t step = 0; step < stepsPerThread; ++step) {
+            Block& slot = window[step % WINDOW];
+            if (slot.p) deallocate(&cache, slot.p, slot.size);
+            random = random * 1664525u + 1013904223u;
+            slot.size = 8 + (random >> 20) % 500;
+            slot.p = allocate(slot.size);
+        }
+        for (Block& slot : window) deallocate(&cache, slot.p, slot.size);
+
+        for (size_t i = 0; i < HANDOFF; ++i) handoff[t].push_back({allocate(64), 64});
+        barrier(1);
+        unsigned neighbour = (t + 1) % threadCount;
+        for (Block& block : handoff[neighbour]) deallocate(caches[neighbour], block.p, block.size);
+        barrier(2); // the neighbour's cache must stay alive until its blocks have been freed
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) threads.emplace_back(worker, t);
+    for (std::thread& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return double(threadCount) * double(stepsPerThread + HANDOFF) / seconds / 1e6;
+}
+
+int main() {
+    // Store scene objects in a slot map instead of allocating each one with new
+    SlotMap<DynamicObject> objects;
+    objects.reserve(1000);
+    std::vector<SlotHandle<DynamicObject>> handles;
+    for (int i = 0; i < 1000; ++i) {
+        handles.push_back(objects.insert({i, float(i), 0.0f, 0.0f, 0.0f, 1.0f, 0.0f}));
+    }
+
+    // Remove every third object; the remaining ones stay packed in one array
+    for (size_t i = 0; i < handles.size(); i += 3) objects.erase(handles[i]);
+
+    // A handle to a removed object is detected as stale instead of pointing at freed memory
+    if (!objects.get(handles[0])) {
+        std::cout << "Handle " << handles[0].packed() << " is stale after erase" << std::endl;
+    }
+    SlotHandle<DynamicObject> reused = objects.insert({1000});
+    std::cout << "Slot " << reused.index << " reused with generation " << reused.generation << "; "
+              << objects.size() << " objects live" << std::endl;
+
+    // Updates are a linear scan over the dense array, with no pointer chasing
+    for (DynamicObject& object : objects) {
+        object.x += object.vx;
+        object.y += object.vy;
+        object.z += object.vz;
+    }
+    if (DynamicObject* object = objects.get(handles[1])) {
+        std::cout << "Object " << object->id << " moved to y = " << object->y << std::endl;
+    }
+
+    // Use shared ownership when several systems must keep the same object alive
+    auto sharedOwnership = std::make_shared<DynamicObject>();
+    std::shared_ptr<DynamicObject> secondOwner = sharedOwnership;
+    secondOwner->id = 2; // both owners see the change; the object is deleted when the last one goes away
+    std::cout << "Shared object " << sharedOwnership->id << " has " << sharedOwnership.use_count() << " owners"
+              << std::endl;
+
+    // Memory allocation on the stack using std::array
+    std::array<int, 3> stackAllocated = {10, 20, 30};
+    std::cout << "Stack array holds " << stackAllocated.size() << " values" << std::endl;
+
+    // Memory fragmentation prevention: route small, short-lived allocations through the pool allocator
+    PoolAllocator pool;
+    {
+        // Mesh and particle systems churn many small containers; simulate a few frames of that
+        std::pmr::vector<std::pmr::vector<float>> particles(&pool);
+        for (int frame = 0; frame < 100; ++frame) {
+            for (int i = 0; i < 200; ++i) {
+                particles.emplace_back(size_t(3 + (frame * 7 + i) % 60), 0.0f);
+            }
+            // Free every other particle buffer, leaving holes that the free lists will reuse next frame
+            for (size_t i = 0; i < particles.size(); i += 2) {
+                particles[i] = std::pmr::vector<float>(&pool);
+            }
+            if (particles.size() > 2000) {
+                particles.erase(particles.begin(), particles.begin() + 1000);
+            }
+        }
+        pool.printReport(std::cout);
+    }
+
+    // Everything went back to the free lists, so the reserved slabs are ready for reuse
+    if (pool.stats().bytesInUse == 0) {
+        std::cout << "All pool blocks were returned; reserved memory stays available for reuse." << std::endl;
     } else {
-        std::cout << "Memory is fragmented." << std::endl;
+        std::cout << "Pool blocks still in use: " << pool.stats().bytesInUse << " bytes." << std::endl;
+    }
+
+    // Parallel mesh jobs: give every worker its own ThreadCache over a shared depot and compare the throughput
+    // with all workers sharing one locked pool
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Allocator stress (million allocate/free pairs per second):" << std::endl;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        double cached = runAllocatorStress(threads, true);
+        double locked = runAllocatorStress(threads, false);
+        std::cout << "  " << threads << " threads: thread caches " << cached << ", locked pool " << locked
+                  << std::endl;
     }
 
     return 0;
 }
 /*
-In this example, we've demonstrated various memory management techniques in C++, including dynamic memory
-allocation using `new` and `delete`, smart pointers with shared ownership, stack-based vs. heap-based memory
-allocation using `std::array` and `std::vector`, and a simple memory fragmentation prevention algorithm.
+In this example, we've demonstrated various memory management techniques in C++, including handle-based object
+storage in a slot map, smart pointers with shared ownership, stack-based vs. heap-based memory
+allocation using `std::array` and `std::vector`, and a pool allocator that prevents memory fragmentation.
+
+The `SlotMap` stores objects contiguously and hands out 32-bit slot indices paired with 32-bit generations.
+Erasing an object moves the last one into its place and bumps the slot's generation, so the array stays free of
+holes and any old handle to the erased object is rejected by `get()` instead of dangling.
+
+The `PoolAllocator` is a `std::pmr::memory_resource`, so any `std::pmr` container can use it. Small requests are
+rounded up to a power-of-two size class and served from fixed-size blocks carved out of 64 KiB slabs; freed blocks
+go onto an intrusive per-class free list and are handed out again first. Because all blocks in a class are the
+same size, a freed block always fits the next request of that class, which is what keeps long-running programs
+from fragmenting. Requests larger than 4 KiB fall back to the upstream resource. `printReport()` shows bytes in
+use versus reserved, internal and external fragmentation, and the occupancy of every size class.
+
+The pool itself is single-threaded. For parallel work, `PoolDepot` puts it behind a mutex and each worker
+allocates through its own `ThreadCache`, which keeps two magazines of free blocks per size class and only talks to
+the depot when both are empty or both are full. Blocks freed by a thread other than the cache's owner go onto a
+lock-free list that the owner drains later, so no free takes a lock on the fast path. `runAllocatorStress()`
+compares this with a single locked pool as the number of workers grows.
 
 Please note that the above code is simplified for illustration purposes only and should not be used in
 production without proper modifications and optimizations to suit your specific use case.
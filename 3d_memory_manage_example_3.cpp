@@ -0,0 +1,453 @@
+/*
+Here's an example of a C++ program that measures memory use instead of guessing at it. It adds an opt-in
+instrumentation layer on top of the techniques shown in the other memory management examples:
+
+1.  **Allocation hooks**: Replacing the global `operator new`/`operator delete` (and, optionally, wrapping
+`malloc`, `calloc`, `realloc` and `free`) so that every heap allocation is recorded.
+2.  **Subsystem tags**: Attributing allocations to scoped tags such as "texture", "mesh" or "anim".
+3.  **Per-frame reports**: Counting allocations per frame to find code that allocates in the steady-state loop.
+4.  **Leak report**: Listing every allocation that is still alive when the program exits.
+
+Tracking is off unless the program is built with it:
+
+    g++ -std=c++17 -O2 -rdynamic -DTRACK_ALLOCATIONS 3d_memory_manage_example_3.cpp -ldl
+
+To count C allocation calls as well, add the malloc wrappers:
+
+    g++ -std=c++17 -O2 -rdynamic -DTRACK_ALLOCATIONS -DTRACK_MALLOC 3d_memory_manage_example_3.cpp -ldl \
+        -Wl,--wrap=malloc -Wl,--wrap=free -Wl,--wrap=calloc -Wl,--wrap=realloc
+*/
+#include <dlfcn.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#ifdef TRACK_MALLOC
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* p, size_t size);
+void __real_free(void* p);
+}
+#endif
+
+// Define the allocation tracker. It must not allocate from the heap itself (it runs inside operator new), so all
+// of its state lives in fixed-size static tables: one open-addressing table of live allocations, one of call
+// sites and one of tags. A spin lock protects them; allocations made while the tables are full are counted as
+// untracked instead of being recorded.
+class AllocationTracker {
+public:
+    static const int MAX_TAGS = 32;
+
+    // Function to look up or add a tag by name; tag 0 is "untagged"
+    static int registerTag(const char* name) {
+        Lock lock;
+        for (int i = 1; i < tagCount; ++i) {
+            if (std::strcmp(tags[i].name, name) == 0) return i;
+        }
+        if (tagCount == MAX_TAGS) return 0;
+        tags[tagCount].name = name;
+        return tagCount++;
+    }
+
+    // Tag that allocations on the calling thread are attributed to
+    static int currentTag() { return threadTag; }
+    static void setCurrentTag(int tag) { threadTag = tag; }
+
+    static void recordAllocation(void* p, size_t size, void* returnAddress) {
+        if (!p) return;
+        Lock lock;
+        int tag = threadTag;
+        int site = findSite(reinterpret_cast<uintptr_t>(returnAddress));
+        if (!insertRecord(reinterpret_cast<uintptr_t>(p), size, tag, site)) {
+            ++untracked;
+            return;
+        }
+
+        TagStats& t = tags[tag];
+        t.liveBytes += size;
+        t.liveCount += 1;
+        t.peakBytes = std::max(t.peakBytes, t.liveBytes);
+        t.frameAllocations += 1;
+        t.frameBytes += size;
+        liveBytes += size;
+        peakBytes = std::max(peakBytes, liveBytes);
+        frameAllocations += 1;
+        frameBytes += size;
+        if (site >= 0) {
+            sites[site].allocations += 1;
+            sites[site].bytes += size;
+        }
+    }
+
+    // Function to forget an allocation; pointers that were never recorded are ignored
+    static void recordFree(void* p) {
+        if (!p) return;
+        Lock lock;
+        Record record;
+        if (!removeRecord(reinterpret_cast<uintptr_t>(p), record)) return;
+        TagStats& t = tags[record.tag];
+        t.liveBytes -= record.size;
+        t.liveCount -= 1;
+        liveBytes -= record.size;
+    }
+
+    // Function to close the current frame and print what it allocated, then start counting the next one
+    static void endFrame(FILE* out) {
+        Lock lock;
+        std::fprintf(out, "Frame %zu: %zu allocations, %zu bytes", frameIndex, frameAllocations, frameBytes);
+        for (int i = 0; i < tagCount; ++i) {
+            if (tags[i].frameAllocations == 0) continue;
+            std::fprintf(out, "; %s %zu (%zu B)", tags[i].name, tags[i].frameAllocations, tags[i].frameBytes);
+            tags[i].frameAllocations = 0;
+            tags[i].frameBytes = 0;
+        }
+        std::fprintf(out, "\n");
+        frameAllocations = 0;
+        frameBytes = 0;
+        ++frameIndex;
+    }
+
+    // Function to print live and peak bytes per tag and the call sites that allocate most often
+    static void printSummary(FILE* out, int topSites = 5) {
+        Lock lock;
+        std::fprintf(out, "Live %zu bytes, peak %zu bytes, %zu untracked allocations\n", liveBytes, peakBytes,
+                     untracked);
+        for (int i = 0; i < tagCount; ++i) {
+            std::fprintf(out, "  %-10s live %8zu B in %5zu blocks, peak %8zu B\n", tags[i].name,
+                         tags[i].liveBytes, tags[i].liveCount, tags[i].peakBytes);
+        }
+
+        static int order[MAX_SITES];
+        int count = 0;
+        for (int i = 0; i < MAX_SITES; ++i) {
+            if (sites[i].address) order[count++] = i;
+        }
+        std::sort(order, order + count, [](int a, int b) { return sites[a].allocations > sites[b].allocations; });
+        std::fprintf(out, "Top allocation sites:\n");
+        for (int i = 0; i < std::min(count, topSites); ++i) {
+            const Site& s = sites[order[i]];
+            std::fprintf(out, "  %8zu allocations %10zu B  ", s.allocations, s.bytes);
+            printAddress(out, s.address);
+        }
+    }
+
+    // Function to list every allocation that is still alive, grouped by tag and call site
+    static void printLeaks(FILE* out) {
+        Lock lock;
+        size_t leaks = 0;
+        for (size_t i = 0; i < TABLE_SIZE; ++i) {
+            const Record& r = records[i];
+            if (!r.address) continue;
+            if (leaks++ < 20) {
+                std::fprintf(out, "  leaked %zu B at %p [%s] from ", r.size, reinterpret_cast<void*>(r.address),
+                             tags[r.tag].name);
+                if (r.site >= 0) {
+                    printAddress(out, sites[r.site].address);
+                } else {
+                    std::fprintf(out, "unknown site\n");
+                }
+            }
+        }
+        std::fprintf(out, "%zu allocations (%zu bytes) still alive at exit\n", leaks, liveBytes);
+    }
+
+    // Function to print the leak report when the program exits
+    static void reportLeaksAtExit() {
+        std::atexit([] { printLeaks(stderr); });
+    }
+
+private:
+    static const size_t TABLE_SIZE = 1 << 18; // live allocations that can be tracked at once
+    static const int MAX_SITES = 4096;
+
+    struct Record {
+        uintptr_t address;
+        size_t size;
+        int16_t site;
+        uint8_t tag;
+    };
+
+    struct Site {
+        uintptr_t address;
+        size_t allocations;
+        size_t bytes;
+    };
+
+    struct TagStats {
+        const char* name;
+        size_t liveBytes, liveCount, peakBytes, frameAllocations, frameBytes;
+    };
+
+    struct Lock {
+        Lock() { while (spin.exchange(true, std::memory_order_acquire)) {} }
+        ~Lock() { spin.store(false, std::memory_order_release); }
+    };
+
+    static size_t slotFor(uintptr_t address, size_t tableSize) {
+        return size_t((address >> 4) * 0x9E3779B97F4A7C15ull >> 20) & (tableSize - 1);
+    }
+
+    static int findSite(uintptr_t address) {
+        size_t slot = slotFor(address, MAX_SITES);
+        for (int probe = 0; probe < MAX_SITES; ++probe, slot = (slot + 1) & (MAX_SITES - 1)) {
+            if (sites[slot].address == address) return int(slot);
+            if (sites[slot].address == 0) {
+                sites[slot].address = address;
+                return int(slot);
+            }
+        }
+        return -1;
+    }
+
+    static bool insertRecord(uintptr_t address, size_t size, int tag, int site) {
+        if (recordCount * 4 >= TABLE_SIZE * 3) return false; // keep probe sequences short
+        size_t slot = slotFor(address, TABLE_SIZE);
+        while (records[slot].address) slot = (slot + 1) & (TABLE_SIZE - 1);
+        records[slot] = {address, size, int16_t(site), uint8_t(tag)};
+        ++recordCount;
+        return true;
+    }
+
+    // Linear probing with backward-shift deletion, so no tombstones accumulate
+    static bool removeRecord(uintptr_t address, Record& removed) {
+        size_t slot = slotFor(address, TABLE_SIZE);
+        while (records[slot].address != address) {
+            if (records[slot].address == 0) return false;
+            slot = (slot + 1) & (TABLE_SIZE - 1);
+        }
+        removed = records[slot];
+        size_t hole = slot;
+        for (size_t next = (hole + 1) & (TABLE_SIZE - 1); records[next].address;
+             next = (next + 1) & (TABLE_SIZE - 1)) {
+            size_t home = slotFor(records[next].address, TABLE_SIZE);
+            // Move the entry back if its home slot is not between the hole and its current slot
+            if (((next - home) & (TABLE_SIZE - 1)) >= ((next - hole) & (TABLE_SIZE - 1))) {
+                records[hole] = records[next];
+                hole = next;
+            }
+        }
+        records[hole] = {};
+        --recordCount;
+        return true;
+    }
+
+    static void printAddress(FILE* out, uintptr_t address) {
+        Dl_info info;
+        if (dladdr(reinterpret_cast<void*>(address), &info) && info.dli_sname) {
+            std::fprintf(out, "%s+0x%zx\n", info.dli_sname,
+                         size_t(address - reinterpret_cast<uintptr_t>(info.dli_saddr)));
+        } else {
+            std::fprintf(out, "%p\n", reinterpret_cast<void*>(address));
+        }
+    }
+
+    static std::atomic<bool> spin;
+    static thread_local int threadTag;
+    static Record records[TABLE_SIZE];
+    static size_t recordCount;
+    static Site sites[MAX_SITES];
+    static TagStats tags[MAX_TAGS];
+    static int tagCount;
+    static size_t liveBytes, peakBytes, untracked;
+    static size_t frameIndex, frameAllocations, frameBytes;
+};
+
+// All tracker state is constant-initialized, so it is ready before any static constructor allocates
+std::atomic<bool> AllocationTracker::spin{false};
+thread_local int AllocationTracker::threadTag = 0;
+AllocationTracker::Record AllocationTracker::records[AllocationTracker::TABLE_SIZE];
+size_t AllocationTracker::recordCount = 0;
+AllocationTracker::Site AllocationTracker::sites[AllocationTracker::MAX_SITES];
+AllocationTracker::TagStats AllocationTracker::tags[AllocationTracker::MAX_TAGS] = {{"untagged", 0, 0, 0, 0, 0}};
+int AllocationTracker::tagCount = 1;
+size_t AllocationTracker::liveBytes = 0, AllocationTracker::peakBytes = 0, AllocationTracker::untracked = 0;
+size_t AllocationTracker::frameIndex = 0, AllocationTracker::frameAllocations = 0,
+       AllocationTracker::frameBytes = 0;
+
+// Define a scope that attributes every allocation made on this thread to a tag until it ends
+class AllocationScope {
+public:
+    explicit AllocationScope(const char* tag) : previous(AllocationTracker::currentTag()) {
+        AllocationTracker::setCurrentTag(AllocationTracker::registerTag(tag));
+    }
+    ~AllocationScope() { AllocationTracker::setCurrentTag(previous); }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    int previous;
+};
+
+#ifdef TRACK_ALLOCATIONS
+#ifdef TRACK_MALLOC
+static void* rawMalloc(size_t size) { return __real_malloc(size); }
+static void rawFree(void* p) { __real_free(p); }
+
+extern "C" void* __wrap_malloc(size_t size) {
+    void* p = __real_malloc(size);
+    AllocationTracker::recordAllocation(p, size, __builtin_return_address(0));
+    return p;
+}
+
+extern "C" void* __wrap_calloc(size_t count, size_t size) {
+    void* p = __real_calloc(count, size);
+    AllocationTracker::recordAllocation(p, count * size, __builtin_return_address(0));
+    return p;
+}
+
+extern "C" void* __wrap_realloc(void* old, size_t size) {
+    void* p = __real_realloc(old, size);
+    if (p || size == 0) {
+        AllocationTracker::recordFree(old);
+        AllocationTracker::recordAllocation(p, size, __builtin_return_address(0));
+    }
+    return p;
+}
+
+extern "C" void __wrap_free(void* p) {
+    AllocationTracker::recordFree(p);
+    __real_free(p);
+}
+#else
+static void* rawMalloc(size_t size) { return std::malloc(size); }
+static void rawFree(void* p) { std::free(p); }
+#endif
+
+static void* trackedNew(size_t size, void* site) {
+    void* p = rawMalloc(size ? size : 1);
+    AllocationTracker::recordAllocation(p, size, site);
+    return p;
+}
+
+static void* trackedAlignedNew(size_t size, std::align_val_t alignment, void* site) {
+    void* p = nullptr;
+    if (posix_memalign(&p, std::max(size_t(alignment), sizeof(void*)), size ? size : 1) != 0) return nullptr;
+    AllocationTracker::recordAllocation(p, size, site);
+    return p;
+}
+
+static void trackedDelete(void* p) {
+    AllocationTracker::recordFree(p);
+    rawFree(p);
+}
+
+void* operator new(size_t size) {
+    void* p = trackedNew(size, __builtin_return_address(0));
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = trackedNew(size, __builtin_return_address(0));
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedNew(size, __builtin_return_address(0)); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedNew(size, __builtin_return_address(0)); }
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    void* p = trackedAlignedNew(size, alignment, __builtin_return_address(0));
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    void* p = trackedAlignedNew(size, alignment, __builtin_return_address(0));
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { trackedDelete(p); }
+void operator delete[](void* p) noexcept { trackedDelete(p); }
+void operator delete(void* p, size_t) noexcept { trackedDelete(p); }
+void operator delete[](void* p, size_t) noexcept { trackedDelete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { trackedDelete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { trackedDelete(p); }
+void operator delete(void* p, std::align_val_t) noexcept { trackedDelete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { trackedDelete(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { trackedDelete(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { trackedDelete(p); }
+#endif
+
+// Define some subsystems of a small engine to measure
+struct Texture {
+    std::vector<unsigned char> pixels;
+};
+
+struct Mesh {
+    std::vector<float> vertices;
+    std::vector<unsigned> indices;
+};
+
+Texture loadTexture(int size) {
+    AllocationScope scope("texture");
+    Texture texture;
+    texture.pixels.resize(size_t(size) * size * 4);
+    return texture;
+}
+
+Mesh* loadMesh(int vertexCount) {
+    AllocationScope scope("mesh");
+    Mesh* mesh = new Mesh;
+    mesh->vertices.resize(size_t(vertexCount) * 3);
+    mesh->indices.resize(size_t(vertexCount) * 6);
+    return mesh;
+}
+
+// Blends two poses; allocates a temporary every call, which is exactly what the per-frame report should expose
+void updateAnimation(std::vector<float>& pose, const std::vector<float>& target, float t) {
+    AllocationScope scope("anim");
+    std::vector<float> blended(pose.size());
+    for (size_t i = 0; i < pose.size(); ++i) blended[i] = pose[i] + (target[i] - pose[i]) * t;
+    pose.swap(blended);
+}
+
+int main() {
+#ifdef TRACK_ALLOCATIONS
+    AllocationTracker::reportLeaksAtExit();
+#else
+    std::printf("Allocation tracking is disabled; rebuild with -DTRACK_ALLOCATIONS to see the reports.\n");
+#endif
+
+    // Load phase
+    std::vector<Texture> textures;
+    textures.reserve(8);
+    for (int i = 0; i < 8; ++i) textures.push_back(loadTexture(256));
+    Mesh* body = loadMesh(20000);
+    Mesh* props = loadMesh(5000); // never deleted: shows up in the leak report
+    AllocationTracker::endFrame(stdout);
+
+    // Steady-state frame loop: ideally every frame reports zero allocations
+    std::vector<float> pose(300, 0.0f), target(300, 1.0f);
+    for (int frame = 0; frame < 5; ++frame) {
+        updateAnimation(pose, target, 0.1f);
+        AllocationTracker::endFrame(stdout);
+    }
+
+    delete body;
+    AllocationTracker::printSummary(stdout);
+    (void)props;
+    return 0;
+}
+/*
+This example shows how to measure memory behaviour instead of only avoiding leaks by construction. With
+`TRACK_ALLOCATIONS` defined, the global `operator new`/`operator delete` are replaced so that every allocation is
+recorded together with the current `AllocationScope` tag and the return address of the caller. Defining
+`TRACK_MALLOC` and linking with `--wrap` does the same for the C allocation functions.
+
+`AllocationTracker::endFrame()` prints how many allocations each tag made during the frame, which makes code that
+allocates in the steady-state loop (here, `updateAnimation()`) easy to spot. `printSummary()` reports live and
+peak bytes per tag and the call sites that allocate most often, and the leak report lists the allocations that
+were never freed. The tracker keeps its own bookkeeping in fixed-size static tables, because it runs inside the
+allocator and must not allocate itself. Without the build flags the hooks are not compiled at all, so the tags
+cost only a thread-local store.
+*/
\ No newline at end of file
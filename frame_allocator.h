@@ -0,0 +1,93 @@
+// Per-frame scratch allocator shared by 3d_example_3.cpp, 3d_example_6.cpp and 3d_example_skybox.cpp
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Define a double-buffered per-frame linear allocator for scratch memory. Allocation bumps an offset through a
+// preallocated buffer, and endFrame() switches to the other buffer and rewinds it, so the render loop never
+// touches the heap. Memory handed out during a frame stays valid until the end of the following frame, which
+// covers data the driver may still be reading. If a frame runs out of space the request falls back to the heap
+// and is counted, so the buffer size can be tuned; those blocks are released when their buffer is rewound.
+// Debug builds fill rewound memory with 0xCD so reads of expired scratch data stand out.
+class FrameAllocator {
+public:
+    explicit FrameAllocator(size_t bytesPerFrame) : capacity(bytesPerFrame) {
+        for (Buffer& buffer : buffers) buffer.memory = static_cast<unsigned char*>(::operator new(capacity));
+    }
+
+    ~FrameAllocator() {
+        for (Buffer& buffer : buffers) {
+            releaseOverflow(buffer);
+            ::operator delete(buffer.memory);
+        }
+    }
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    // Function to get scratch memory for this frame; alignment must be a power of two no larger than 64
+    void* allocate(size_t bytes, size_t alignment = 16) {
+        Buffer& buffer = buffers[current];
+        uintptr_t base = reinterpret_cast<uintptr_t>(buffer.memory);
+        uintptr_t aligned = (base + buffer.offset + alignment - 1) & ~uintptr_t(alignment - 1);
+        if (aligned + bytes <= base + capacity) {
+            buffer.offset = aligned + bytes - base;
+            peakBytes = std::max(peakBytes, buffer.offset);
+            return reinterpret_cast<void*>(aligned);
+        }
+
+        ++overflowCount;
+        overflowBytes += bytes;
+        void* p = ::operator new(bytes, std::align_val_t(64));
+        buffer.overflow.push_back(p);
+        return p;
+    }
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T) < 16 ? 16 : alignof(T)));
+    }
+
+    // Function to finish the frame: the other buffer, last used two frames ago, becomes current and is rewound
+    void endFrame() {
+        current ^= 1;
+        Buffer& buffer = buffers[current];
+#ifndef NDEBUG
+        std::memset(buffer.memory, 0xCD, buffer.offset);
+#endif
+        buffer.offset = 0;
+        releaseOverflow(buffer);
+    }
+
+    size_t bytesUsed() const { return buffers[current].offset; }
+    size_t getPeakBytes() const { return peakBytes; }
+    size_t getOverflowCount() const { return overflowCount; }
+    size_t getOverflowBytes() const { return overflowBytes; }
+
+private:
+    struct Buffer {
+        unsigned char* memory = nullptr;
+        size_t offset = 0;
+        std::vector<void*> overflow;
+    };
+
+    static void releaseOverflow(Buffer& buffer) {
+        for (void* p : buffer.overflow) ::operator delete(p, std::align_val_t(64));
+        buffer.overflow.clear();
+    }
+
+    size_t capacity;
+    Buffer buffers[2];
+    int current = 0;
+    size_t peakBytes = 0;
+    size_t overflowCount = 0;
+    size_t overflowBytes = 0;
+};
+
+#endif // FRAME_ALLOCATOR_H
@@ -0,0 +1,473 @@
+// Triangle meshes and the quadric edge-collapse simplifier shared by 3d_lod_example_1.cpp and 3d_lod_example_2.cpp
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Define a 3D point structure
+struct Point {
+    float x, y, z;
+
+    // Constructor to initialize point with coordinates
+    Point(float x = 0.0f, float y = 0.0f, float z = 0.0f) : x(x), y(y), z(z) {}
+
+    // Function to draw the point as a sphere in SFML window
+    void draw(sf::RenderWindow& window) {
+        sf::SphereShape sphere(2);
+        sphere.setPosition(x, y, z);
+        window.draw(sphere);
+    }
+};
+
+// Define a texture coordinate structure
+struct TexCoord {
+    float u, v;
+};
+
+// Indexed triangle mesh with one texture coordinate per vertex. Vertices on a UV seam share a position but
+// not a texture coordinate, so they are stored as separate entries, as they would be in a GPU vertex buffer.
+// Positions stay interleaved {x, y, z} rather than split into arrays as in 3d_example_5.cpp: the simplifier reads
+// whole vertices by index in random order.
+struct TriangleMesh {
+    std::vector<Point> positions;
+    std::vector<TexCoord> texCoords;
+    std::vector<unsigned> indices; // three per triangle
+
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+
+// Symmetric 4x4 error quadric (Garland & Heckbert). Evaluating it at a point gives the sum of squared distances
+// from that point to every plane accumulated into it.
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+    // Plane ax + by + cz + d = 0 with unit normal (a, b, c), scaled by weight
+    static Quadric fromPlane(double a, double b, double c, double d, double weight) {
+        Quadric q;
+        q.a2 = weight * a * a; q.ab = weight * a * b; q.ac = weight * a * c; q.ad = weight * a * d;
+        q.b2 = weight * b * b; q.bc = weight * b * c; q.bd = weight * b * d;
+        q.c2 = weight * c * c; q.cd = weight * c * d;
+        q.d2 = weight * d * d;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+        b2 += o.b2; bc += o.bc; bd += o.bd;
+        c2 += o.c2; cd += o.cd;
+        d2 += o.d2;
+        return *this;
+    }
+
+    double evaluate(const Point& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                       b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                       c2 * z * z + 2 * cd * z + d2;
+        return error > 0.0 ? error : 0.0; // rounding can push an exact fit slightly negative
+    }
+};
+
+// Extra weight of the planes that pin border edges in place, so open borders do not shrink or wander
+const double BORDER_WEIGHT = 10.0;
+
+// Offline mesh simplifier: repeatedly collapses the cheapest edge according to its quadric error.
+// Collapses are half-edge collapses (a vertex merges into one of its neighbours), so surviving vertices keep
+// their original position and texture coordinate. Vertices on a UV seam are never moved, and a vertex on an
+// open border may only slide along that border. The quadric cost only orders the collapses: it sums squared
+// distances to many planes, border planes weighted, so it is not a distance. The error reported for the result
+// is measured separately, as the distance from the original vertices to the simplified surface. Every collapse
+// is logged so it can be replayed backwards as a vertex split.
+class MeshSimplifier {
+public:
+    // One logged collapse, in the simplifier's original vertex and triangle numbering
+    struct CollapseRecord {
+        unsigned from, to;
+        std::vector<unsigned> removedTriangles; // triangles that contained both ends of the edge
+        std::vector<unsigned> changedCorners;   // triangle * 3 + corner slots that were moved from 'from' to 'to'
+    };
+
+    explicit MeshSimplifier(const TriangleMesh& mesh)
+        : positions(mesh.positions), texCoords(mesh.texCoords), triangles(mesh.indices),
+          triangleAlive(mesh.triangleCount(), true), liveTriangles(mesh.triangleCount()),
+          vertexTriangles(mesh.positions.size()), quadrics(mesh.positions.size()),
+          removed(mesh.positions.size(), false), locked(mesh.positions.size(), false),
+          border(mesh.positions.size(), false), stamps(mesh.positions.size(), 0),
+          mergedInto(mesh.positions.size()) {
+        for (unsigned v = 0; v < mergedInto.size(); ++v) mergedInto[v] = v;
+        for (unsigned t = 0; t < triangleAlive.size(); ++t) {
+            for (int k = 0; k < 3; ++k) vertexTriangles[triangles[t * 3 + k]].push_back(t);
+        }
+
+        accumulateFaceQuadrics();
+        detectBordersAndSeams();
+
+        // Queue every edge once
+        std::vector<uint64_t> edges;
+        edges.reserve(triangles.size());
+        for (unsigned t = 0; t < triangleAlive.size(); ++t) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned a = triangles[t * 3 + k], b = triangles[t * 3 + (k + 1) % 3];
+                edges.push_back(edgeKey(std::min(a, b), std::max(a, b)));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        for (uint64_t key : edges) queueEdge(unsigned(key >> 32), unsigned(key & 0xFFFFFFFFu));
+    }
+
+    // Function to collapse edges until at most targetTriangles remain or no legal collapse is left
+    void simplifyTo(size_t targetTriangles) {
+        while (liveTriangles > targetTriangles && !queue.empty()) {
+            Candidate c = queue.top();
+            queue.pop();
+
+            // Entries are never updated in place; anything queued before a neighbourhood changed is stale
+            if (removed[c.from] || removed[c.to] || stamps[c.from] != c.fromStamp || stamps[c.to] != c.toStamp)
+                continue;
+            if (!isCollapseLegal(c.from, c.to)) continue;
+
+            collapse(c.from, c.to);
+        }
+    }
+
+    size_t triangleCount() const { return liveTriangles; }
+
+    // Function to measure the largest distance, in world units, from an original vertex to the current surface.
+    // The largest result so far is returned, which keeps the errors of a LOD chain non-decreasing.
+    float error() {
+        maxError = std::max(maxError, measureDeviation());
+        return maxError;
+    }
+
+    // Collapses performed so far, oldest first
+    const std::vector<CollapseRecord>& history() const { return collapses; }
+
+    bool isVertexRemoved(unsigned v) const { return removed[v]; }
+    bool isTriangleAlive(unsigned t) const { return triangleAlive[t]; }
+
+    // Corner of a triangle; a removed triangle keeps the corners it had when it was removed
+    unsigned corner(unsigned t, int k) const { return triangles[t * 3 + k]; }
+
+    // Function to copy out the current mesh with unused vertices dropped
+    TriangleMesh extract() const {
+        TriangleMesh mesh;
+        std::vector<unsigned> remap(positions.size(), ~0u);
+        for (unsigned t = 0; t < triangleAlive.size(); ++t) {
+            if (!triangleAlive[t]) continue;
+            for (int k = 0; k < 3; ++k) {
+                unsigned v = triangles[t * 3 + k];
+                if (remap[v] == ~0u) {
+                    remap[v] = unsigned(mesh.positions.size());
+                    mesh.positions.push_back(positions[v]);
+                    mesh.texCoords.push_back(texCoords[v]);
+                }
+                mesh.indices.push_back(remap[v]);
+            }
+        }
+        return mesh;
+    }
+
+private:
+    struct Candidate {
+        double cost;
+        unsigned from, to;
+        unsigned fromStamp, toStamp;
+
+        // std::priority_queue is a max-heap, so invert the order to pop the cheapest collapse first
+        bool operator<(const Candidate& other) const { return cost > other.cost; }
+    };
+
+    static uint64_t edgeKey(unsigned a, unsigned b) { return (uint64_t(a) << 32) | b; }
+
+    static void faceNormal(const Point& p0, const Point& p1, const Point& p2, double n[3]) {
+        double e1[3] = {double(p1.x) - p0.x, double(p1.y) - p0.y, double(p1.z) - p0.z};
+        double e2[3] = {double(p2.x) - p0.x, double(p2.y) - p0.y, double(p2.z) - p0.z};
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    // Function to find the squared distance from p to the closest point of triangle abc (Ericson, Real-Time
+    // Collision Detection, 5.1.5): the closest point lies in one of the triangle's vertex, edge or face regions
+    static double pointTriangleDistanceSq(const Point& p, const Point& a, const Point& b, const Point& c) {
+        double ab[3] = {double(b.x) - a.x, double(b.y) - a.y, double(b.z) - a.z};
+        double ac[3] = {double(c.x) - a.x, double(c.y) - a.y, double(c.z) - a.z};
+        double ap[3] = {double(p.x) - a.x, double(p.y) - a.y, double(p.z) - a.z};
+        double bp[3] = {double(p.x) - b.x, double(p.y) - b.y, double(p.z) - b.z};
+        double cp[3] = {double(p.x) - c.x, double(p.y) - c.y, double(p.z) - c.z};
+        auto dot = [](const double* u, const double* v) { return u[0] * v[0] + u[1] * v[1] + u[2] * v[2]; };
+        auto lengthSq = [&](const double* u) { return dot(u, u); };
+
+        double d1 = dot(ab, ap), d2 = dot(ac, ap);
+        if (d1 <= 0.0 && d2 <= 0.0) return lengthSq(ap);
+        double d3 = dot(ab, bp), d4 = dot(ac, bp);
+        if (d3 >= 0.0 && d4 <= d3) return lengthSq(bp);
+        double d5 = dot(ab, cp), d6 = dot(ac, cp);
+        if (d6 >= 0.0 && d5 <= d6) return lengthSq(cp);
+
+        // Closest point a + v * ab + w * ac, on an edge or inside the face
+        double v, w;
+        double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+        if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+            v = d1 / (d1 - d3), w = 0.0;
+        } else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+            v = 0.0, w = d2 / (d2 - d6);
+        } else if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+            w = (d4 - d3) / ((d4 - d3) + (d5 - d6)), v = 1.0 - w;
+        } else {
+            double denom = 1.0 / (va + vb + vc);
+            v = vb * denom, w = vc * denom;
+        }
+        double offset[3];
+        for (int k = 0; k < 3; ++k) offset[k] = ap[k] - ab[k] * v - ac[k] * w;
+        return lengthSq(offset);
+    }
+
+    // Function to measure how far the current surface has moved away from the original vertices. A vertex is
+    // measured against the live triangles around the vertex it was merged into (itself if it survived); the
+    // closest point of the whole surface can only be nearer, so the result bounds the true distance from above.
+    float measureDeviation() {
+        double worstSq = 0.0;
+        for (unsigned v = 0; v < positions.size(); ++v) {
+            unsigned survivor = v;
+            while (removed[survivor]) survivor = mergedInto[survivor];
+            mergedInto[v] = survivor; // shortens the chain for later calls
+
+            double bestSq = HUGE_VAL;
+            for (unsigned t : vertexTriangles[survivor]) {
+                if (!triangleAlive[t]) continue;
+                const unsigned* tri = &triangles[t * 3];
+                bestSq = std::min(bestSq, pointTriangleDistanceSq(positions[v], positions[tri[0]],
+                                                                  positions[tri[1]], positions[tri[2]]));
+            }
+            if (bestSq == HUGE_VAL) { // no triangle left around it; fall back to the survivor itself
+                const Point& p = positions[v];
+                const Point& q = positions[survivor];
+                double dx = double(p.x) - q.x, dy = double(p.y) - q.y, dz = double(p.z) - q.z;
+                bestSq = dx * dx + dy * dy + dz * dz;
+            }
+            worstSq = std::max(worstSq, bestSq);
+        }
+        return float(std::sqrt(worstSq));
+    }
+
+    void accumulateFaceQuadrics() {
+        for (unsigned t = 0; t < triangleAlive.size(); ++t) {
+            const unsigned* tri = &triangles[t * 3];
+            double n[3];
+            faceNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]], n);
+            double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0.0) continue; // zero-area triangle has no plane
+            n[0] /= length; n[1] /= length; n[2] /= length;
+            const Point& p = positions[tri[0]];
+            double d = -(n[0] * p.x + n[1] * p.y + n[2] * p.z);
+
+            Quadric q = Quadric::fromPlane(n[0], n[1], n[2], d, 1.0);
+            for (int k = 0; k < 3; ++k) quadrics[tri[k]] += q;
+        }
+    }
+
+    void detectBordersAndSeams() {
+        // Vertices that share a position with another vertex sit on a UV seam; keep them fixed
+        std::unordered_map<uint64_t, std::vector<unsigned>> byPosition;
+        for (unsigned v = 0; v < positions.size(); ++v) {
+            uint32_t bits[3];
+            std::memcpy(bits, &positions[v].x, sizeof(float));
+            std::memcpy(bits + 1, &positions[v].y, sizeof(float));
+            std::memcpy(bits + 2, &positions[v].z, sizeof(float));
+            uint64_t hash = (uint64_t(bits[0]) * 73856093u) ^ (uint64_t(bits[1]) * 19349663u) ^
+                            (uint64_t(bits[2]) * 83492791u);
+            std::vector<unsigned>& bucket = byPosition[hash];
+            for (unsigned other : bucket) {
+                const Point& a = positions[other];
+                const Point& b = positions[v];
+                if (a.x == b.x && a.y == b.y && a.z == b.z) locked[other] = locked[v] = true;
+            }
+            bucket.push_back(v);
+        }
+
+        // Edges used by a single triangle form the open border
+        std::unordered_map<uint64_t, unsigned> edgeUse;
+        for (unsigned t = 0; t < triangleAlive.size(); ++t) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned a = triangles[t * 3 + k], b = triangles[t * 3 + (k + 1) % 3];
+                ++edgeUse[edgeKey(std::min(a, b), std::max(a, b))];
+            }
+        }
+        for (unsigned t = 0; t < triangleAlive.size(); ++t) {
+            const unsigned* tri = &triangles[t * 3];
+            for (int k = 0; k < 3; ++k) {
+                unsigned a = tri[k], b = tri[(k + 1) % 3];
+                if (edgeUse[edgeKey(std::min(a, b), std::max(a, b))] != 1) continue;
+                border[a] = border[b] = true;
+
+                // Plane through the border edge, perpendicular to the face, resists moving off the border
+                double n[3];
+                faceNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]], n);
+                const Point& pa = positions[a];
+                const Point& pb = positions[b];
+                double e[3] = {double(pb.x) - pa.x, double(pb.y) - pa.y, double(pb.z) - pa.z};
+                double c[3] = {e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0]};
+                double length = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+                if (length == 0.0) continue;
+                c[0] /= length; c[1] /= length; c[2] /= length;
+                double d = -(c[0] * pa.x + c[1] * pa.y + c[2] * pa.z);
+
+                Quadric q = Quadric::fromPlane(c[0], c[1], c[2], d, BORDER_WEIGHT);
+                quadrics[a] += q;
+                quadrics[b] += q;
+            }
+        }
+    }
+
+    void queueEdge(unsigned a, unsigned b) {
+        for (int direction = 0; direction < 2; ++direction) {
+            unsigned from = direction == 0 ? a : b;
+            unsigned to = direction == 0 ? b : a;
+            if (locked[from]) continue;
+
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            queue.push({q.evaluate(positions[to]), from, to, stamps[from], stamps[to]});
+        }
+    }
+
+    bool triangleContains(unsigned t, unsigned v) const {
+        return triangles[t * 3] == v || triangles[t * 3 + 1] == v || triangles[t * 3 + 2] == v;
+    }
+
+    // Function to gather the distinct neighbours of a vertex over its live triangles
+    void collectNeighbours(unsigned v, std::vector<unsigned>& out) const {
+        out.clear();
+        for (unsigned t : vertexTriangles[v]) {
+            if (!triangleAlive[t]) continue;
+            for (int k = 0; k < 3; ++k) {
+                unsigned w = triangles[t * 3 + k];
+                if (w != v && std::find(out.begin(), out.end(), w) == out.end()) out.push_back(w);
+            }
+        }
+    }
+
+    bool isCollapseLegal(unsigned from, unsigned to) {
+        unsigned sharedTriangles = 0;
+        for (unsigned t : vertexTriangles[from]) {
+            if (triangleAlive[t] && triangleContains(t, to)) ++sharedTriangles;
+        }
+        if (sharedTriangles == 0) return false;
+
+        // A border vertex may only move along a border edge, or the border would be torn open
+        if (border[from] && sharedTriangles != 1) return false;
+
+        // Link condition: the endpoints may only share the neighbours opposite the edge, otherwise the
+        // collapse pinches the surface into a non-manifold fin
+        collectNeighbours(from, scratchA);
+        collectNeighbours(to, scratchB);
+        unsigned common = 0;
+        for (unsigned w : scratchA) {
+            if (std::find(scratchB.begin(), scratchB.end(), w) != scratchB.end()) ++common;
+        }
+        if (common > sharedTriangles) return false;
+
+        // Reject collapses that would flip a surviving triangle
+        for (unsigned t : vertexTriangles[from]) {
+            if (!triangleAlive[t] || triangleContains(t, to)) continue;
+            Point before[3], after[3];
+            for (int k = 0; k < 3; ++k) {
+                unsigned v = triangles[t * 3 + k];
+                before[k] = positions[v];
+                after[k] = v == from ? positions[to] : positions[v];
+            }
+            double n0[3], n1[3];
+            faceNormal(before[0], before[1], before[2], n0);
+            faceNormal(after[0], after[1], after[2], n1);
+            if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0) return false;
+        }
+        return true;
+    }
+
+    void collapse(unsigned from, unsigned to) {
+        CollapseRecord record{from, to, {}, {}};
+        for (unsigned t : vertexTriangles[from]) {
+            if (!triangleAlive[t]) continue;
+            if (triangleContains(t, to)) {
+                triangleAlive[t] = false;
+                --liveTriangles;
+                record.removedTriangles.push_back(t);
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                if (triangles[t * 3 + k] == from) {
+                    triangles[t * 3 + k] = to;
+                    record.changedCorners.push_back(t * 3 + k);
+                }
+            }
+            vertexTriangles[to].push_back(t);
+        }
+        collapses.push_back(std::move(record));
+        vertexTriangles[from].clear();
+        removed[from] = true;
+        mergedInto[from] = to;
+        quadrics[to] += quadrics[from];
+
+        // Every edge around the surviving vertex now has a different cost
+        ++stamps[to];
+        collectNeighbours(to, scratchA);
+        for (unsigned w : scratchA) queueEdge(to, w);
+    }
+
+    std::vector<Point> positions;
+    std::vector<TexCoord> texCoords;
+    std::vector<unsigned> triangles;
+    std::vector<bool> triangleAlive;
+    size_t liveTriangles;
+    std::vector<std::vector<unsigned>> vertexTriangles;
+    std::vector<Quadric> quadrics;
+    std::vector<bool> removed;
+    std::vector<bool> locked;
+    std::vector<bool> border;
+    std::vector<unsigned> stamps;
+    std::vector<unsigned> mergedInto; // for a removed vertex, a vertex it was merged into
+    std::priority_queue<Candidate> queue;
+    std::vector<unsigned> scratchA, scratchB;
+    std::vector<CollapseRecord> collapses;
+    float maxError = 0.0f;
+};
+
+// Function to build a bumpy UV sphere. The texture seam at u = 0/1 and the poles duplicate positions with
+// different texture coordinates, like a typical exported model.
+TriangleMesh makeBumpySphere(float radius, int rings, int segments, const Point& center) {
+    TriangleMesh mesh;
+    for (int r = 0; r <= rings; ++r) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; ++s) {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            float bump = 1.0f + 0.05f * std::sin(5.0f * theta) * std::cos(7.0f * phi);
+            float sx = std::sin(theta) * std::cos(phi), sy = std::cos(theta), sz = std::sin(theta) * std::sin(phi);
+            if (s == segments) { // seam copy must match the first column exactly
+                sx = std::sin(theta); sz = 0.0f;
+                bump = 1.0f + 0.05f * std::sin(5.0f * theta);
+            }
+            mesh.positions.push_back(Point(center.x + radius * bump * sx, center.y + radius * bump * sy,
+                                           center.z + radius * bump * sz));
+            mesh.texCoords.push_back({float(s) / segments, float(r) / rings});
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            unsigned a = r * (segments + 1) + s, b = a + segments + 1;
+            if (r != 0) mesh.indices.insert(mesh.indices.end(), {a, a + 1, b});
+            if (r != rings - 1) mesh.indices.insert(mesh.indices.end(), {a + 1, b + 1, b});
+        }
+    }
+    return mesh;
+}
+
+#endif // MESH_SIMPLIFIER_H
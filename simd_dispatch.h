@@ -0,0 +1,43 @@
+// Instruction-set dispatch shared by 3d_example_5.cpp, 3d_example_adv_linear_alg.cpp,
+// 3d_example_check_malformation.cpp and 3d_example_clothing_2.cpp
+#ifndef SIMD_DISPATCH_H
+#define SIMD_DISPATCH_H
+
+// Instruction-set paths a kernel can run on, from slowest to fastest
+enum class SimdPath { Scalar, SSE2, AVX2, AVX512 };
+
+inline const char* simdPathName(SimdPath path) {
+    switch (path) {
+        case SimdPath::SSE2: return "SSE2";
+        case SimdPath::AVX2: return "AVX2";
+        case SimdPath::AVX512: return "AVX-512";
+        default: return "scalar";
+    }
+}
+
+// Function to check whether the running CPU can execute a given path
+inline bool isSimdPathSupported(SimdPath path) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    switch (path) {
+        case SimdPath::SSE2: return __builtin_cpu_supports("sse2");
+        case SimdPath::AVX2: return __builtin_cpu_supports("avx2");
+        case SimdPath::AVX512: return __builtin_cpu_supports("avx512f");
+        default: return true;
+    }
+#else
+    return path == SimdPath::Scalar;
+#endif
+}
+
+// Function to pick the widest path the running CPU supports. A file whose narrowest SIMD kernel is wider than
+// SSE2 passes that path as `narrowest`, so a CPU below it gets the scalar path instead of one with no kernel.
+inline SimdPath detectSimdPath(SimdPath narrowest = SimdPath::SSE2) {
+    for (SimdPath path : {SimdPath::AVX512, SimdPath::AVX2, SimdPath::SSE2}) {
+        if (path < narrowest) break;
+        if (isSimdPathSupported(path)) return path;
+    }
+    return SimdPath::Scalar;
+}
+
+#endif
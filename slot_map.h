@@ -0,0 +1,117 @@
+// Generational handles and the slot map shared by 3d_memory_manage_example_2.cpp, 3d_example_clothing.cpp and
+// 3d_example_clothing_2.cpp
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Define a generational handle: a slot index plus the generation the slot had when the handle was issued. The
+// type parameter keeps handles of different containers from being mixed up. Generation 0 is never issued, so a
+// default-constructed handle is always invalid.
+template <typename T>
+struct SlotHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    uint64_t packed() const { return (uint64_t(generation) << 32) | index; }
+    bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Define a slot map: objects are stored densely in one vector and referred to through generational handles.
+// Insert, erase and lookup are O(1): a handle selects a slot, the slot points at the object's position in the dense
+// array, and erasing moves the last object into the hole so the array never has gaps. Each erase bumps the slot's
+// generation, which makes every handle to the erased object stale instead of dangling. Iteration walks the dense
+// array directly. Pointers and references to objects are invalidated by insert and erase; keep handles instead.
+template <typename T>
+class SlotMap {
+public:
+    using Handle = SlotHandle<T>;
+
+    // Function to add an object and return the handle that refers to it from now on
+    Handle insert(T value) {
+        uint32_t index;
+        if (freeHead != NO_SLOT) {
+            index = freeHead;
+            freeHead = slots[index].denseIndex;
+        } else {
+            index = uint32_t(slots.size());
+            slots.push_back({0, 1});
+        }
+        slots[index].denseIndex = uint32_t(dense.size());
+        dense.push_back(std::move(value));
+        denseToSlot.push_back(index);
+        return {index, slots[index].generation};
+    }
+
+    // Function to remove an object; returns false if the handle was already stale
+    bool erase(Handle handle) {
+        if (!contains(handle)) return false;
+        Slot& slot = slots[handle.index];
+        uint32_t hole = slot.denseIndex;
+        uint32_t last = uint32_t(dense.size() - 1);
+        if (hole != last) {
+            dense[hole] = std::move(dense[last]);
+            denseToSlot[hole] = denseToSlot[last];
+            slots[denseToSlot[hole]].denseIndex = hole;
+        }
+        dense.pop_back();
+        denseToSlot.pop_back();
+
+        if (++slot.generation == 0) slot.generation = 1;
+        slot.denseIndex = freeHead;
+        freeHead = handle.index;
+        return true;
+    }
+
+    bool contains(Handle handle) const {
+        return handle.index < slots.size() && handle.generation != 0 &&
+               slots[handle.index].generation == handle.generation;
+    }
+
+    // Function to look up an object; returns nullptr for a stale handle
+    T* get(Handle handle) { return contains(handle) ? &dense[slots[handle.index].denseIndex] : nullptr; }
+    const T* get(Handle handle) const { return contains(handle) ? &dense[slots[handle.index].denseIndex] : nullptr; }
+
+    // Function to find the handle of the object at a position of the dense array
+    Handle handleAt(size_t denseIndex) const {
+        uint32_t index = denseToSlot[denseIndex];
+        return {index, slots[index].generation};
+    }
+
+    void clear() {
+        for (size_t i = dense.size(); i > 0; --i) erase(handleAt(i - 1));
+    }
+
+    void reserve(size_t count) {
+        dense.reserve(count);
+        denseToSlot.reserve(count);
+        slots.reserve(count);
+    }
+
+    size_t size() const { return dense.size(); }
+    bool empty() const { return dense.empty(); }
+    T* data() { return dense.data(); }
+    typename std::vector<T>::iterator begin() { return dense.begin(); }
+    typename std::vector<T>::iterator end() { return dense.end(); }
+    typename std::vector<T>::const_iterator begin() const { return dense.begin(); }
+    typename std::vector<T>::const_iterator end() const { return dense.end(); }
+
+private:
+    static constexpr uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    struct Slot {
+        uint32_t denseIndex; // position in the dense array, or the next free slot while the slot is free
+        uint32_t generation;
+    };
+
+    std::vector<T> dense;
+    std::vector<uint32_t> denseToSlot;
+    std::vector<Slot> slots;
+    uint32_t freeHead = NO_SLOT;
+};
+
+#endif
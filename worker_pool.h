@@ -0,0 +1,106 @@
+// Worker thread pool shared by 3d_example_5.cpp, 3d_example_check_malformation.cpp and 3d_example_clothing_2.cpp
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that execute one parallelFor() at a time. The calling thread takes part in
+// the work too, so a pool built for N hardware threads starts N - 1 workers.
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned threadCount = std::thread::hardware_concurrency()) {
+        for (unsigned i = 1; i < std::max(threadCount, 1u); ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Function to run body(chunk) for every chunk in [0, chunkCount). Threads pull chunk indices from a shared
+    // counter, so a thread that drew cheap chunks simply takes more of them. Returns once every chunk is done.
+    void parallelFor(std::size_t chunkCount, const std::function<void(std::size_t)>& body) {
+        if (chunkCount == 0) return;
+        if (workers.empty() || chunkCount == 1) {
+            for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) body(chunk);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &body;
+            jobChunks = chunkCount;
+            nextChunk.store(0, std::memory_order_relaxed);
+            busyWorkers = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+
+        runChunks(body, chunkCount);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    void runChunks(const std::function<void(std::size_t)>& body, std::size_t chunkCount) {
+        for (;;) {
+            std::size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunkCount) break;
+            body(chunk);
+        }
+    }
+
+    void workerLoop() {
+        std::size_t seenGeneration = 0;
+        for (;;) {
+            const std::function<void(std::size_t)>* body;
+            std::size_t chunkCount;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+                body = job;
+                chunkCount = jobChunks;
+            }
+
+            runChunks(*body, chunkCount);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0) done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(std::size_t)>* job = nullptr;
+    std::size_t jobChunks = 0;
+    std::atomic<std::size_t> nextChunk{0};
+    std::size_t busyWorkers = 0;
+    std::size_t generation = 0;
+    bool stopping = false;
+};
+
+#endif